@@ -1,4 +1,10 @@
 #include "BasicLightning.h"
+#include "MaterialTable.h"
+#include "Mesh.h"
+#include "GLState.h"
+#include <algorithm>
+#include <random>
+#include <chrono>
 
 namespace LOGL
 {
@@ -6,106 +12,468 @@ namespace LOGL
 	{
 	}
 
-	void BasicLightning::init()
+	void BasicLightning::init(const ShaderDefines& defines)
 	{
-		m_Shader = std::make_unique<Shader>(Shader("shaders/basic_lightningvs.glsl", "shaders/basic_lightningfs.glsl"));
+		m_Shader = submitVariant(defines, false);
+		m_DirLightsOnly = defines.count("DIR_LIGHTS_ONLY") != 0;
+		setupShader();
 
-		m_Shader->use();
-		m_Shader->setInt("material.diffuse", 0);
-		m_Shader->setInt("material.specular", 1);
-		m_Shader->setFloat("material.shininess", 32.0f);
+		GLint maxTexels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		// 65536 is the minimum GL 3.3 guarantees
+		int texelsPerLight = sizeof(LightSourceStd140) / (4 * sizeof(float));
+		m_MaxLights = std::min(MAX_LIGHT_SOURCE, std::max(maxTexels, 65536) / texelsPerLight);
+
+		glGenBuffers(1, &m_LightsBuffer);
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, m_LightsBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, m_MaxLights * sizeof(LightSourceStd140), NULL, GL_DYNAMIC_DRAW);
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glGenTextures(1, &m_LightsTexture);
+		GLState.bindTexture(GL_TEXTURE_BUFFER, m_LightsTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_LightsBuffer);
+		GLState.bindTexture(GL_TEXTURE_BUFFER, 0);
+
+		m_Clusters.init();
+	}
+
+	std::shared_ptr<Shader> BasicLightning::submitVariant(const ShaderDefines& defines, bool async)
+	{
+		// limits shared with the C++ side always come from here
+		ShaderDefines variant = defines;
+		variant["MAX_DIR_LIGHTS"] = std::to_string(MAX_DIR_LIGHTS);
+		variant["CLUSTER_GRID_X"] = std::to_string(CLUSTER_GRID_X);
+		variant["CLUSTER_GRID_Y"] = std::to_string(CLUSTER_GRID_Y);
+		variant["CLUSTER_GRID_Z"] = std::to_string(CLUSTER_GRID_Z);
+		variant["MAX_MATERIALS"] = std::to_string(MAX_MATERIALS);
+		variant["MATERIAL_ARRAY_COUNT"] = std::to_string(MaterialTable::getArrayCount());
+		return Shader::getVariant("shaders/basic_lightningvs.glsl", "shaders/basic_lightningfs.glsl", variant, async);
 	}
 
-	void BasicLightning::use(Camera& camera, glm::mat4& proj)
+	void BasicLightning::requestVariant(const ShaderDefines& defines)
 	{
+		m_PendingShader = submitVariant(defines, true);
+		m_PendingDirLightsOnly = defines.count("DIR_LIGHTS_ONLY") != 0;
+	}
+
+	void BasicLightning::setupShader()
+	{
+		MaterialTable::setupShader(*m_Shader);
+		m_Shader->setInt("lightData", LIGHT_DATA_UNIT);
+		m_Shader->setInt("clusterGrid", CLUSTER_GRID_UNIT);
+		m_Shader->setInt("lightIndices", LIGHT_INDEX_UNIT);
+
+		resolveLocations();
+		m_DirLightsDirty = true;
+	}
+
+	void BasicLightning::resolveLocations()
+	{
+		m_ClusterDepthParamsLoc = m_Shader->getLocation("clusterDepthParams");
+		m_DirLightIndicesLoc = m_Shader->getLocation("dirLightIndices");
+		m_DirLightCountLoc = m_Shader->getLocation("dirLightCount");
+		m_ShaderRevision = m_Shader->getRevision();
+	}
+
+	void BasicLightning::use()
+	{
+		// swap once the requested variant is done, a failed one is dropped
+		if (m_PendingShader && m_PendingShader->isReady())
+		{
+			if (m_PendingShader->isValid())
+			{
+				m_Shader = m_PendingShader;
+				m_DirLightsOnly = m_PendingDirLightsOnly;
+				setupShader();
+			}
+			m_PendingShader.reset();
+		}
+
 		m_Shader->use();
+		// a hot-reloaded program keeps its uniform values but may move them
+		if (m_ShaderRevision != m_Shader->getRevision())
+			resolveLocations();
+		uploadLights();
+		if (m_DirLightsDirty)
+			updateDirLights();
 
-		m_Shader->setMat4("view", camera.GetViewMatrix());
-		m_Shader->setMat4("projection", proj);
-		m_Shader->setVec3("viewPos", camera.Position);
+		GLState.bindTextureUnit(LIGHT_DATA_UNIT, GL_TEXTURE_BUFFER, m_LightsTexture);
+		m_Clusters.bind(GL_TEXTURE0 + CLUSTER_GRID_UNIT, GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+		m_Shader->setVec2(m_ClusterDepthParamsLoc, m_Clusters.getDepthParams());
 	}
 
-	void BasicLightning::setModelMat(glm::mat4& model)
+	void BasicLightning::uploadLights()
 	{
-		m_Shader->setMat4("model", model);
+		m_DirtyEnd = std::min(m_DirtyEnd, m_LightData.size() * sizeof(LightSourceStd140));
+		if (m_DirtyEnd > m_DirtyBegin)
+		{
+			GLState.bindBuffer(GL_TEXTURE_BUFFER, m_LightsBuffer);
+			glBufferSubData(GL_TEXTURE_BUFFER, m_DirtyBegin, m_DirtyEnd - m_DirtyBegin, (char*)m_LightData.data() + m_DirtyBegin);
+			m_DirtyBegin = m_DirtyEnd = 0;
+		}
+	}
+
+	void BasicLightning::updateDirLights()
+	{
+		m_DirLights.clear();
+		for (int i = 0; i < (int)m_LightData.size(); i++)
+		{
+			if (!m_LightData[i].isDirLight)
+				continue;
+			if (m_DirLights.size() == MAX_DIR_LIGHTS)
+			{
+				LOGL::warning("void BasicLightning::updateDirLights() -> max directional light source == %d", MAX_DIR_LIGHTS);
+				break;
+			}
+			m_DirLights.push_back(i);
+		}
+
+		if (!m_DirLights.empty())
+			glUniform1iv(m_DirLightIndicesLoc, (GLsizei)m_DirLights.size(), m_DirLights.data());
+		m_Shader->setInt(m_DirLightCountLoc, (int)m_DirLights.size());
+		m_DirLightsDirty = false;
+	}
+
+	void BasicLightning::assignLights(Camera& camera, glm::mat4& proj)
+	{
+		if (m_DirLightsOnly)
+			return;
+		m_Clusters.assign(m_LightData.data(), (int)m_LightData.size(), camera.GetViewMatrix(), proj);
+	}
+
+	void BasicLightning::setModelMat(glm::mat4& model, GLint material)
+	{
+		setInstanceAttribs(model, material);
 	}
 
 	void BasicLightning::addLightSource(LightSource& ls)
 	{
-		if (m_Lights.size() == MAX_LIGHT_SOURCE)
+		if ((int)m_Lights.size() >= m_MaxLights)
 		{
-			LOGL::warning("void BasicLightning::addLightSource(LightSource ls) -> max light source == %d", MAX_LIGHT_SOURCE);
+			LOGL::warning("void BasicLightning::addLightSource(LightSource ls) -> max light source == %d", m_MaxLights);
 			return;
 		}
 
 		m_Lights.push_back(ls);
+		m_LightData.emplace_back();
 		editLightSource(m_Lights.size() - 1, ls);
 	}
 
 	void BasicLightning::editLightSource(int ID, LightSource& ls)
 	{
-		if (ID < 0 && ID > MAX_LIGHT_SOURCE)
+		if (ID < 0 || ID >= (int)m_Lights.size())
 		{
 			LOGL::error("void BasicLightning::editLightSource(int ID, LightSource ls) -> Wrong ID");
 			return;
 		}
 
-		m_Shader->use();
-		std::string lsname = "lightSources[" + std::to_string(ID) + "].";
-
-		m_Shader->setVec3(lsname + "direction", ls.direction);
-		m_Shader->setVec3(lsname + "ambient", ls.ambient);
-		m_Shader->setVec3(lsname + "diffuse", ls.diffuse);
-		m_Shader->setVec3(lsname + "specular", ls.specular);
-
-		if (ls.isDirLight)
-		{
-			m_Shader->setInt(lsname + "isDirLight", 1);
-		}
-		else
-		{
-			m_Shader->setInt(lsname + "isDirLight", 0);
-			m_Shader->setVec3(lsname + "position", ls.position);
-			m_Shader->setFloat(lsname + "constant", ls.constant);
-			m_Shader->setFloat(lsname + "linear", ls.linear);
-			m_Shader->setFloat(lsname + "quadratic", ls.quadratic);
-			m_Shader->setFloat(lsname + "spotCutoff", ls.spotCutoff);
-		}
-
-		m_Shader->setInt("enabledLightSourceCount", m_Lights.size());
+		m_Lights.at(ID) = ls;
+		writeLightSource(ID, ls);
 	}
 
 	void BasicLightning::removeLightSource(int ID)
 	{
-		if (ID < 0 && ID >= m_Lights.size())
+		if (ID < 0 || ID >= (int)m_Lights.size())
 		{
 			LOGL::error("void BasicLightning::removeLightSource(int ID) -> Wrong ID");
 			return;
 		}
 
-		if (m_Lights.size() == 1 || ID == MAX_LIGHT_SOURCE - 1)
+		int last = (int)m_Lights.size() - 1;
+		m_Lights.at(ID) = m_Lights.at(last);
+		m_Lights.pop_back();
+
+		if (m_LightData[last].isDirLight)
+			m_DirLightsDirty = true;
+		m_LightData.pop_back();
+
+		// the freed slot is never referenced by the cluster lists, only the moved light is uploaded
+		if (ID != last)
+			writeLightSource(ID, m_Lights.at(ID));
+	}
+
+	void BasicLightning::writeLightSource(int slot, const LightSource& ls)
+	{
+		LightSourceStd140& dst = m_LightData[slot];
+		if (dst.isDirLight || ls.isDirLight)
+			m_DirLightsDirty = true;
+
+		dst.isDirLight = ls.isDirLight ? 1 : 0;
+		dst.position = ls.position;
+		dst.direction = ls.direction;
+		dst.constant = ls.constant;
+		dst.linear = ls.linear;
+		dst.quadratic = ls.quadratic;
+		dst.spotCutoff = ls.spotCutoff;
+		dst.ambient = ls.ambient;
+		dst.diffuse = ls.diffuse;
+		dst.specular = ls.specular;
+
+		markDirty(slot * sizeof(LightSourceStd140), sizeof(LightSourceStd140));
+	}
+
+	void BasicLightning::markDirty(size_t offset, size_t size)
+	{
+		if (m_DirtyEnd == m_DirtyBegin)
 		{
-			m_Lights.pop_back();
-			LightSource ls = {};
-			editLightSource(ID, ls);
+			m_DirtyBegin = offset;
+			m_DirtyEnd = offset + size;
 			return;
 		}
-
-		m_Lights.at(ID) = m_Lights.at(m_Lights.size() - 1);
-		m_Lights.pop_back();
-
-		LightSource ls = {};
-		editLightSource(m_Lights.size() - 1, ls);
-		editLightSource(ID, m_Lights.at(ID));
+		m_DirtyBegin = std::min(m_DirtyBegin, offset);
+		m_DirtyEnd = std::max(m_DirtyEnd, offset + size);
 	}
 
 	LightSource* BasicLightning::getLightSource(int ID)
 	{
-		if (ID < 0 && ID >= m_Lights.size())
+		if (ID < 0 || ID >= (int)m_Lights.size())
 		{
 			LOGL::error("LightSource* BasicLightning::getLightSource(int ID) -> Wrong ID");
 			return nullptr;
 		}
 		return &m_Lights.at(ID);
 	}
+
+	const std::vector<LightSourceStd140>& BasicLightning::getLightData() const
+	{
+		return m_LightData;
+	}
+
+	GLuint BasicLightning::getLightDataTexture() const
+	{
+		return m_LightsTexture;
+	}
+
+	int BasicLightning::getMaxLights() const
+	{
+		return m_MaxLights;
+	}
+
+	bool benchmarkLights(BasicLightning& lighting, int count, const std::function<void(bool deferred)>& drawFrame)
+	{
+		std::vector<int> counts;
+		if (count > 0)
+			counts.push_back(count);
+		else
+			counts = { 1024, 4096, 16384 };
+		// 16k lights need a texture buffer over the 65536 texels GL 3.3 guarantees
+		for (int& target : counts)
+			target = std::min(target, lighting.getMaxLights());
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> x(-20.0f, 20.0f), y(-1.5f, 3.0f), z(-40.0f, 2.0f), color(0.0f, 0.5f);
+		int lights = (int)lighting.getLightData().size();
+		GLuint timeQuery = 0;
+		glGenQueries(1, &timeQuery);
+		for (int target : counts)
+		{
+			// the counts grow, lights of the previous one are kept
+			for (; lights < target; lights++)
+			{
+				LightSource light;
+				light.isDirLight = false;
+				light.position = glm::vec3(x(random), y(random), z(random));
+				light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+				// reach about 1.5 units, even 16k lights leave a few dozen per cluster
+				light.linear = 10.0f;
+				light.quadratic = 50.0f;
+				light.ambient = glm::vec3(0.0f);
+				light.diffuse = glm::vec3(color(random), color(random), color(random));
+				light.specular = light.diffuse;
+				lighting.addLightSource(light);
+			}
+
+			for (int path = 0; path < 2; path++)
+			{
+				double seconds = 0.0;
+				GLuint64 gpuNanoseconds = 0;
+				// the first frame uploads the new lights, it isn't counted
+				for (int frame = 0; frame <= LIGHT_BENCH_FRAMES; frame++)
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+					auto start = std::chrono::steady_clock::now();
+					drawFrame(path == 1);
+					glEndQuery(GL_TIME_ELAPSED);
+					glFinish();
+					double frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					GLuint64 nanoseconds = 0;
+					glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &nanoseconds);
+					if (frame > 0)
+					{
+						seconds += frameSeconds;
+						gpuNanoseconds += nanoseconds;
+					}
+				}
+				LOGL::log("bool benchmarkLights(BasicLightning& lighting, int count, const std::function<void(bool deferred)>& drawFrame) -> %5d lights %-8s frame %8.3f ms  GPU %8.3f ms",
+					lights, path == 0 ? "forward" : "deferred", seconds * 1000.0 / LIGHT_BENCH_FRAMES, gpuNanoseconds / 1e6 / LIGHT_BENCH_FRAMES);
+			}
+		}
+
+		glDeleteQueries(1, &timeQuery);
+		return true;
+	}
+
+	bool benchmarkFragments(BasicLightning& lighting, GLint material, const std::function<void(int width, int height)>& bindShading)
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		GLuint framebuffer, renderbuffers[2];
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(2, renderbuffers);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, FRAGMENT_BENCH_WIDTH, FRAGMENT_BENCH_HEIGHT);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, FRAGMENT_BENCH_WIDTH, FRAGMENT_BENCH_HEIGHT);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		if (!complete)
+			LOGL::error("bool benchmarkFragments(BasicLightning& lighting, GLint material, const std::function<void(int width, int height)>& bindShading) -> %dx%d framebuffer incomplete", FRAGMENT_BENCH_WIDTH, FRAGMENT_BENCH_HEIGHT);
+
+		if (complete)
+		{
+			// the scene's two lights plus six point lights in front of the quad, eight like before clustering
+			for (int i = 0; i < 6; i++)
+			{
+				LightSource light;
+				light.isDirLight = false;
+				light.position = glm::vec3((i % 3 - 1) * 1.5f, (i / 3) * 1.5f - 0.75f, 1.0f);
+				light.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+				light.ambient = glm::vec3(0.0f);
+				light.diffuse = glm::vec3(0.5f);
+				light.specular = glm::vec3(0.5f);
+				lighting.addLightSource(light);
+			}
+
+			// at z = 0 the scene's camera, 3 units back with a 45 degree 16:9 projection, sees
+			// 2.2 x 1.25 units to each side; the quad covers all of it
+			Vertex vertices[] = {
+				{{-2.5f, -1.5f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+				{{2.5f, -1.5f, 0.0f}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+				{{2.5f, 1.5f, 0.0f}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+				{{2.5f, 1.5f, 0.0f}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+				{{-2.5f, 1.5f, 0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+				{{-2.5f, -1.5f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}
+			};
+			MeshBuilder builder;
+			builder.addTriangles(vertices, sizeof(vertices) / sizeof(vertices[0]));
+			Mesh quad = builder.build();
+
+			glViewport(0, 0, FRAGMENT_BENCH_WIDTH, FRAGMENT_BENCH_HEIGHT);
+			bindShading(FRAGMENT_BENCH_WIDTH, FRAGMENT_BENCH_HEIGHT);
+			glm::mat4 model = glm::mat4(1.0f);
+			lighting.setModelMat(model, material);
+
+			GLuint timeQuery = 0;
+			glGenQueries(1, &timeQuery);
+			double seconds = 0.0;
+			GLuint64 gpuNanoseconds = 0;
+			// the first frame warms up the driver, it isn't counted
+			for (int frame = 0; frame <= FRAGMENT_BENCH_FRAMES; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+				auto start = std::chrono::steady_clock::now();
+				drawMesh(quad);
+				glEndQuery(GL_TIME_ELAPSED);
+				glFinish();
+				double frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				GLuint64 nanoseconds = 0;
+				glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &nanoseconds);
+				if (frame > 0)
+				{
+					seconds += frameSeconds;
+					gpuNanoseconds += nanoseconds;
+				}
+			}
+			double pixels = (double)FRAGMENT_BENCH_WIDTH * FRAGMENT_BENCH_HEIGHT;
+			LOGL::log("bool benchmarkFragments(BasicLightning& lighting, GLint material, const std::function<void(int width, int height)>& bindShading) -> %dx%d, 8 lights: frame %8.3f ms  GPU %8.3f ms (%.2f ns/pixel)",
+				FRAGMENT_BENCH_WIDTH, FRAGMENT_BENCH_HEIGHT, seconds * 1000.0 / FRAGMENT_BENCH_FRAMES, gpuNanoseconds / 1e6 / FRAGMENT_BENCH_FRAMES,
+				gpuNanoseconds / pixels / FRAGMENT_BENCH_FRAMES);
+
+			glDeleteQueries(1, &timeQuery);
+			GLuint buffers[] = { quad.VBO, quad.EBO };
+			GLState.deleteBuffers(2, buffers);
+			GLState.deleteVertexArrays(1, &quad.VAO);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(2, renderbuffers);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		return complete;
+	}
+
+	bool benchmarkVertices(BasicLightning& lighting, int segments, GLint material, GLuint statsQuery, const std::function<void(int width, int height)>& bindShading)
+	{
+		if (segments < 3)
+			return false;
+
+		MeshBuilder builder;
+		builder.setLogging(false);
+		addSphere(builder, segments);
+		Mesh sphere = builder.build();
+		GLsizei indexCount = sphere.lods.empty() ? sphere.indexCount : (GLsizei)sphere.lods[0].indexCount;
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glViewport(0, 0, VERTEX_BENCH_SIZE, VERTEX_BENCH_SIZE);
+		bindShading(VERTEX_BENCH_SIZE, VERTEX_BENCH_SIZE);
+		GLuint timeQuery = 0;
+		glGenQueries(1, &timeQuery);
+
+		double seconds = 0.0;
+		GLuint64 gpuNanoseconds = 0;
+		GLuint64 invocations = 0;
+		// the first frame uploads and warms up the driver, it isn't counted
+		for (int frame = 0; frame <= VERTEX_BENCH_FRAMES; frame++)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+			if (statsQuery)
+				glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, statsQuery);
+			auto start = std::chrono::steady_clock::now();
+			for (int draw = 0; draw < VERTEX_BENCH_DRAWS; draw++)
+			{
+				// a new rotation every draw, the normal matrix is computed each time like for a moving object
+				glm::mat4 model = glm::rotate(glm::mat4(1.0f), draw * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+				lighting.setModelMat(model, material);
+				drawMesh(sphere);
+			}
+			glEndQuery(GL_TIME_ELAPSED);
+			if (statsQuery)
+				glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+			glFinish();
+			double frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			GLuint64 nanoseconds = 0, frameInvocations = 0;
+			glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &nanoseconds);
+			if (statsQuery)
+				glGetQueryObjectui64v(statsQuery, GL_QUERY_RESULT, &frameInvocations);
+			if (frame > 0)
+			{
+				seconds += frameSeconds;
+				gpuNanoseconds += nanoseconds;
+				invocations += frameInvocations;
+			}
+		}
+
+		// indices are the vertices submitted, the post-transform cache shades fewer
+		double vertexCount = (double)indexCount * VERTEX_BENCH_DRAWS * VERTEX_BENCH_FRAMES;
+		LOGL::log("bool benchmarkVertices(BasicLightning& lighting, int segments, GLint material, GLuint statsQuery, const std::function<void(int width, int height)>& bindShading) -> %d triangles x %d draws: frame %8.3f ms (%7.1f Mvert/s)  GPU %8.3f ms (%7.1f Mvert/s)",
+			indexCount / 3, VERTEX_BENCH_DRAWS, seconds * 1000.0 / VERTEX_BENCH_FRAMES, vertexCount / seconds / 1e6,
+			gpuNanoseconds / 1e6 / VERTEX_BENCH_FRAMES, gpuNanoseconds ? vertexCount / (gpuNanoseconds / 1e9) / 1e6 : 0.0);
+		if (statsQuery)
+			LOGL::log("bool benchmarkVertices(BasicLightning& lighting, int segments, GLint material, GLuint statsQuery, const std::function<void(int width, int height)>& bindShading) -> %.2f vertex shader invocations per index, %.1f M/s shaded",
+				invocations / vertexCount, invocations / seconds / 1e6);
+
+		glDeleteQueries(1, &timeQuery);
+		GLuint buffers[] = { sphere.VBO, sphere.EBO };
+		GLState.deleteBuffers(2, buffers);
+		GLState.deleteVertexArrays(1, &sphere.VAO);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		return true;
+	}
 }
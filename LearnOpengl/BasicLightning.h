@@ -3,10 +3,29 @@
 #include "Shader.h"
 #include "glm/glm.hpp"
 #include <vector>
+#include <memory>
+#include <functional>
 #include "logger.h"
 #include "Camera.h"
+#include "LightClusters.h"
+#include "InstanceBuffer.h"
 
-#define MAX_LIGHT_SOURCE 8 
+// capped further by GL_MAX_TEXTURE_BUFFER_SIZE, GL 3.3 only guarantees 65536 texels (13107 lights)
+#define MAX_LIGHT_SOURCE 16384
+#define LIGHT_DATA_UNIT 2
+#define CLUSTER_GRID_UNIT 3
+#define LIGHT_INDEX_UNIT 4
+#define MAX_DIR_LIGHTS 8
+// frames every light count of benchmarkLights is timed over, per path
+#define LIGHT_BENCH_FRAMES 10
+// target and frames of benchmarkFragments
+#define FRAGMENT_BENCH_WIDTH 3840
+#define FRAGMENT_BENCH_HEIGHT 2160
+#define FRAGMENT_BENCH_FRAMES 10
+// viewport, frames and draws per frame of benchmarkVertices
+#define VERTEX_BENCH_SIZE 64
+#define VERTEX_BENCH_FRAMES 10
+#define VERTEX_BENCH_DRAWS 20
 
 namespace LOGL
 {
@@ -27,21 +46,93 @@ namespace LOGL
         glm::vec3 specular;
     };
 
+    // GPU layout of LightSource, five RGBA32F texels of the lightData texture buffer
+    struct LightSourceStd140
+    {
+        glm::vec3 position;
+        float constant;
+        glm::vec3 direction;
+        float linear;
+        glm::vec3 ambient;
+        float quadratic;
+        glm::vec3 diffuse;
+        float spotCutoff;
+        glm::vec3 specular;
+        int isDirLight;
+    };
+    static_assert(sizeof(LightSourceStd140) == 80, "LightSourceStd140 must be five vec4");
+
     class BasicLightning
     {
     public:
         BasicLightning();
-        void init();
-        void use(Camera& camera, glm::mat4& proj);
-        void setModelMat(glm::mat4& model);
+        // defines select a variant of basic_lightningfs: NO_SPECULAR, DIR_LIGHTS_ONLY, DIR_LIGHT_COUNT
+        void init(const ShaderDefines& defines = ShaderDefines());
+        // compiles the variant in the background, the current one is used until it's ready
+        void requestVariant(const ShaderDefines& defines);
+        void use();
+        // bins lights into view clusters, call once per frame before use()
+        void assignLights(Camera& camera, glm::mat4& proj);
+        // uploads edited lights to the lightData buffer, done by use() as well
+        void uploadLights();
+        // model matrix and MaterialTable index for the next non-instanced draw
+        void setModelMat(glm::mat4& model, GLint material = 0);
 
+        // ignored with a warning once getMaxLights() lights exist
         void addLightSource(LightSource& ls);
         void editLightSource(int ID, LightSource& ls);
         void removeLightSource(int ID);
         LightSource* getLightSource(int ID);
+
+        const std::vector<LightSourceStd140>& getLightData() const;
+        GLuint getLightDataTexture() const;
+        // MAX_LIGHT_SOURCE or fewer if the lightData texture buffer can't hold them, valid after init()
+        int getMaxLights() const;
     private:
-        std::unique_ptr<Shader> m_Shader;
+        std::shared_ptr<Shader> submitVariant(const ShaderDefines& defines, bool async);
+        void setupShader();
+        void resolveLocations();
+        void writeLightSource(int slot, const LightSource& ls);
+        void markDirty(size_t offset, size_t size);
+        void updateDirLights();
+
+        LightClusters m_Clusters;
+
+        std::shared_ptr<Shader> m_Shader;
+        bool m_DirLightsOnly = false;
+        std::shared_ptr<Shader> m_PendingShader;
+        bool m_PendingDirLightsOnly = false;
         std::vector<LightSource> m_Lights;
+
+        // uniform locations, resolved again when the shader is reloaded
+        unsigned int m_ShaderRevision = 0;
+        GLint m_ClusterDepthParamsLoc;
+        GLint m_DirLightIndicesLoc;
+        GLint m_DirLightCountLoc;
+
+        // directional lights are shaded for every fragment, outside of the clusters
+        std::vector<GLint> m_DirLights;
+        bool m_DirLightsDirty = true;
+
+        // CPU mirror of the lightData buffer, only [m_DirtyBegin, m_DirtyEnd) is uploaded
+        int m_MaxLights = MAX_LIGHT_SOURCE;
+        GLuint m_LightsBuffer = 0;
+        GLuint m_LightsTexture = 0;
+        std::vector<LightSourceStd140> m_LightData;
+        size_t m_DirtyBegin = 0;
+        size_t m_DirtyEnd = 0;
     };
 
+    // adds point lights to lighting, count of them or 1k, 4k and 16k with count 0, and times
+    // drawFrame(false) on the forward path and drawFrame(true) on the deferred one per count
+    bool benchmarkLights(BasicLightning& lighting, int count, const std::function<void(bool deferred)>& drawFrame);
+
+    // adds six point lights to lighting and shades one quad covering a 3840x2160 framebuffer with
+    // material; bindShading(width, height) binds the program and frame state for the target
+    bool benchmarkFragments(BasicLightning& lighting, GLint material, const std::function<void(int width, int height)>& bindShading);
+
+    // times a UV sphere of segments x segments / 2 quads drawn with material through setModelMat() into
+    // a 64x64 viewport, where fragments cost next to nothing, and logs million vertices per second;
+    // statsQuery counts vertex shader invocations when it isn't 0
+    bool benchmarkVertices(BasicLightning& lighting, int segments, GLint material, GLuint statsQuery, const std::function<void(int width, int height)>& bindShading);
 }
\ No newline at end of file
@@ -0,0 +1,434 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+namespace LOGL
+{
+	static uint16_t packRGB565(const float* color)
+	{
+		int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+		int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	static void unpackRGB565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// the four colors of a BC1 block in four color mode
+	static void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3])
+	{
+		unpackRGB565(c0, palette[0]);
+		unpackRGB565(c1, palette[1]);
+		for (int i = 0; i < 3; i++)
+		{
+			palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+			palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+		}
+	}
+
+	// nearest palette entry per texel, returns the squared error of the block
+	static int colorIndices(const unsigned char* texels, uint16_t c0, uint16_t c1, uint32_t& indices)
+	{
+		int palette[4][3];
+		colorPalette(c0, c1, palette);
+
+		int error = 0;
+		indices = 0;
+		for (int t = 0; t < 16; t++)
+		{
+			const unsigned char* texel = texels + t * 4;
+			int best = 0;
+			int bestError = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = texel[0] - palette[p][0];
+				int dg = texel[1] - palette[p][1];
+				int db = texel[2] - palette[p][2];
+				int e = dr * dr + dg * dg + db * db;
+				if (e < bestError)
+				{
+					bestError = e;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (t * 2);
+			error += bestError;
+		}
+		return error;
+	}
+
+	// endpoints at the extremes of the texels along their principal axis
+	static void fitColorEndpoints(const unsigned char* texels, float* end0, float* end1)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int t = 0; t < 16; t++)
+			for (int i = 0; i < 3; i++)
+				mean[i] += texels[t * 4 + i] / 16.0f;
+
+		float covariance[6] = {};
+		for (int t = 0; t < 16; t++)
+		{
+			float d[3] = { texels[t * 4] - mean[0], texels[t * 4 + 1] - mean[1], texels[t * 4 + 2] - mean[2] };
+			covariance[0] += d[0] * d[0];
+			covariance[1] += d[0] * d[1];
+			covariance[2] += d[0] * d[2];
+			covariance[3] += d[1] * d[1];
+			covariance[4] += d[1] * d[2];
+			covariance[5] += d[2] * d[2];
+		}
+
+		// power iteration from the luminance direction
+		float axis[3] = { 0.299f, 0.587f, 0.114f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[3] = {
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+			};
+			float length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+			if (length < 1e-6f)
+				break;
+			for (int i = 0; i < 3; i++)
+				axis[i] = next[i] / length;
+		}
+
+		float minProjection = 1e30f;
+		float maxProjection = -1e30f;
+		int minTexel = 0;
+		int maxTexel = 0;
+		for (int t = 0; t < 16; t++)
+		{
+			float projection = texels[t * 4] * axis[0] + texels[t * 4 + 1] * axis[1] + texels[t * 4 + 2] * axis[2];
+			if (projection < minProjection)
+			{
+				minProjection = projection;
+				minTexel = t;
+			}
+			if (projection > maxProjection)
+			{
+				maxProjection = projection;
+				maxTexel = t;
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			end0[i] = texels[maxTexel * 4 + i];
+			end1[i] = texels[minTexel * 4 + i];
+		}
+	}
+
+	// least squares endpoints for fixed indices, false if every texel uses one weight
+	static bool refineColorEndpoints(const unsigned char* texels, uint32_t indices, float* end0, float* end1)
+	{
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+		for (int t = 0; t < 16; t++)
+		{
+			float a = weights[(indices >> (t * 2)) & 3];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int i = 0; i < 3; i++)
+			{
+				ax[i] += a * texels[t * 4 + i];
+				bx[i] += b * texels[t * 4 + i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+		for (int i = 0; i < 3; i++)
+		{
+			end0[i] = (ax[i] * bb - bx[i] * ab) / determinant;
+			end1[i] = (bx[i] * aa - ax[i] * ab) / determinant;
+		}
+		return true;
+	}
+
+	static void encodeColorBlock(const unsigned char* texels, unsigned char* block)
+	{
+		float end0[3], end1[3];
+		fitColorEndpoints(texels, end0, end1);
+		uint16_t c0 = packRGB565(end0);
+		uint16_t c1 = packRGB565(end1);
+		uint32_t indices;
+		int error = colorIndices(texels, c0, c1, indices);
+
+		if (refineColorEndpoints(texels, indices, end0, end1))
+		{
+			uint16_t r0 = packRGB565(end0);
+			uint16_t r1 = packRGB565(end1);
+			uint32_t refined;
+			if (colorIndices(texels, r0, r1, refined) < error)
+			{
+				c0 = r0;
+				c1 = r1;
+				indices = refined;
+			}
+		}
+
+		// c0 > c1 selects four color mode, swapping the endpoints swaps index 0 with 1 and 2 with 3
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			indices ^= 0x55555555;
+		}
+		else if (c0 == c1)
+			indices = 0;
+
+		block[0] = c0 & 0xFF;
+		block[1] = c0 >> 8;
+		block[2] = c1 & 0xFF;
+		block[3] = c1 >> 8;
+		for (int i = 0; i < 4; i++)
+			block[4 + i] = (indices >> (i * 8)) & 0xFF;
+	}
+
+	// BC3 alpha and BC4/BC5 channel block in eight value mode
+	static void encodeChannelBlock(const unsigned char* texels, int channel, unsigned char* block)
+	{
+		int minValue = 255;
+		int maxValue = 0;
+		for (int t = 0; t < 16; t++)
+		{
+			minValue = std::min(minValue, (int)texels[t * 4 + channel]);
+			maxValue = std::max(maxValue, (int)texels[t * 4 + channel]);
+		}
+
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * maxValue + (i - 1) * minValue) / 7;
+
+		uint64_t indices = 0;
+		if (maxValue > minValue)
+		{
+			for (int t = 0; t < 16; t++)
+			{
+				int value = texels[t * 4 + channel];
+				int best = 0;
+				for (int p = 1; p < 8; p++)
+				{
+					if (std::abs(value - palette[p]) < std::abs(value - palette[best]))
+						best = p;
+				}
+				indices |= (uint64_t)best << (t * 3);
+			}
+		}
+
+		block[0] = (unsigned char)maxValue;
+		block[1] = (unsigned char)minValue;
+		for (int i = 0; i < 6; i++)
+			block[2 + i] = (indices >> (i * 8)) & 0xFF;
+	}
+
+	static void decodeColorBlock(const unsigned char* block, unsigned char* texels)
+	{
+		uint16_t c0 = block[0] | (block[1] << 8);
+		uint16_t c1 = block[2] | (block[3] << 8);
+		uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+		int palette[4][3];
+		colorPalette(c0, c1, palette);
+		bool transparent = false;
+		// c0 <= c1 is the three color mode, index 3 is transparent black
+		if (c0 <= c1)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+				palette[3][i] = 0;
+			}
+			transparent = true;
+		}
+
+		for (int t = 0; t < 16; t++)
+		{
+			int index = (indices >> (t * 2)) & 3;
+			for (int i = 0; i < 3; i++)
+				texels[t * 4 + i] = (unsigned char)palette[index][i];
+			texels[t * 4 + 3] = transparent && index == 3 ? 0 : 255;
+		}
+	}
+
+	static void decodeChannelBlock(const unsigned char* block, int channel, unsigned char* texels)
+	{
+		int palette[8];
+		palette[0] = block[0];
+		palette[1] = block[1];
+		if (palette[0] > palette[1])
+		{
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+				palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+		for (int t = 0; t < 16; t++)
+			texels[t * 4 + channel] = (unsigned char)palette[(indices >> (t * 3)) & 7];
+	}
+
+	size_t getBlockSize(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			return 8;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	size_t getCompressedSize(GLenum format, int width, int height)
+	{
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+	}
+
+	bool isCompressedFormatSupported(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return GLExt.EXT_texture_compression_s3tc;
+		case GL_COMPRESSED_RG_RGTC2:
+			return true;
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return GLExt.ARB_texture_compression_bptc;
+		default:
+			return false;
+		}
+	}
+
+	void encodeBlockBC1(const unsigned char* texels, unsigned char* block)
+	{
+		encodeColorBlock(texels, block);
+	}
+
+	void encodeBlockBC3(const unsigned char* texels, unsigned char* block)
+	{
+		encodeChannelBlock(texels, 3, block);
+		encodeColorBlock(texels, block + 8);
+	}
+
+	void encodeBlockBC5(const unsigned char* texels, unsigned char* block)
+	{
+		encodeChannelBlock(texels, 0, block);
+		encodeChannelBlock(texels, 1, block + 8);
+	}
+
+	void decodeBlockBC1(const unsigned char* block, unsigned char* texels)
+	{
+		decodeColorBlock(block, texels);
+	}
+
+	void decodeBlockBC3(const unsigned char* block, unsigned char* texels)
+	{
+		decodeColorBlock(block + 8, texels);
+		decodeChannelBlock(block, 3, texels);
+	}
+
+	void decodeBlockBC5(const unsigned char* block, unsigned char* texels)
+	{
+		decodeChannelBlock(block, 0, texels);
+		decodeChannelBlock(block + 8, 1, texels);
+		for (int t = 0; t < 16; t++)
+		{
+			texels[t * 4 + 2] = 0;
+			texels[t * 4 + 3] = 255;
+		}
+	}
+
+	bool compressImage(const unsigned char* rgba, int width, int height, GLenum format, unsigned char* blocks)
+	{
+		void (*encode)(const unsigned char*, unsigned char*) = nullptr;
+		if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+			encode = encodeBlockBC1;
+		else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+			encode = encodeBlockBC3;
+		else if (format == GL_COMPRESSED_RG_RGTC2)
+			encode = encodeBlockBC5;
+		else
+			return false;
+
+		size_t blockSize = getBlockSize(format);
+		unsigned char texels[64];
+		for (int by = 0; by < height; by += 4)
+		{
+			for (int bx = 0; bx < width; bx += 4)
+			{
+				for (int y = 0; y < 4; y++)
+				{
+					int sy = std::min(by + y, height - 1);
+					for (int x = 0; x < 4; x++)
+					{
+						int sx = std::min(bx + x, width - 1);
+						memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+					}
+				}
+				encode(texels, blocks);
+				blocks += blockSize;
+			}
+		}
+		return true;
+	}
+
+	bool decompressImage(const unsigned char* blocks, int width, int height, GLenum format, unsigned char* rgba)
+	{
+		void (*decode)(const unsigned char*, unsigned char*) = nullptr;
+		if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+			decode = decodeBlockBC1;
+		else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+			decode = decodeBlockBC3;
+		else if (format == GL_COMPRESSED_RG_RGTC2)
+			decode = decodeBlockBC5;
+		else
+			return false;
+
+		size_t blockSize = getBlockSize(format);
+		unsigned char texels[64];
+		for (int by = 0; by < height; by += 4)
+		{
+			for (int bx = 0; bx < width; bx += 4)
+			{
+				decode(blocks, texels);
+				blocks += blockSize;
+				for (int y = 0; y < 4 && by + y < height; y++)
+				{
+					int columns = std::min(4, width - bx);
+					memcpy(rgba + ((size_t)(by + y) * width + bx) * 4, texels + y * 16, columns * 4);
+				}
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "GLExtensions.h"
+#include <cstddef>
+
+namespace LOGL
+{
+    // 8 for BC1, 16 for BC3, BC5 and BC7, 0 for formats that aren't block compressed
+    size_t getBlockSize(GLenum format);
+    // bytes of a width x height image, partial blocks at the edges are whole blocks
+    size_t getCompressedSize(GLenum format, int width, int height);
+
+    // true if the driver takes format in glCompressedTexImage2D
+    bool isCompressedFormatSupported(GLenum format);
+
+    // blocks are 4x4 RGBA8 texels, row major; BC1 is encoded opaque, BC5 keeps red and green
+    void encodeBlockBC1(const unsigned char* texels, unsigned char* block);
+    void encodeBlockBC3(const unsigned char* texels, unsigned char* block);
+    void encodeBlockBC5(const unsigned char* texels, unsigned char* block);
+
+    void decodeBlockBC1(const unsigned char* block, unsigned char* texels);
+    void decodeBlockBC3(const unsigned char* block, unsigned char* texels);
+    // blue is 0 and alpha 255
+    void decodeBlockBC5(const unsigned char* block, unsigned char* texels);
+
+    // whole images of RGBA8 texels, edge texels are repeated into partial blocks;
+    // false if format has no encoder or decoder here (BC7)
+    bool compressImage(const unsigned char* rgba, int width, int height, GLenum format, unsigned char* blocks);
+    bool decompressImage(const unsigned char* blocks, int width, int height, GLenum format, unsigned char* rgba);
+}
@@ -7,6 +7,32 @@ namespace LOGL
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	Frustum Camera::GetFrustum(const glm::mat4& projection)
+	{
+		return Frustum::fromMatrix(projection * GetViewMatrix());
+	}
+
+	Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+	{
+		// Gribb/Hartmann: -w <= x, y, z <= w in clip space, each bound is the
+		// last row of the matrix plus or minus one of the others
+		const glm::mat4& m = viewProjection;
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+		Frustum frustum;
+		frustum.planes[LEFT] = rows[3] + rows[0];
+		frustum.planes[RIGHT] = rows[3] - rows[0];
+		frustum.planes[BOTTOM] = rows[3] + rows[1];
+		frustum.planes[TOP] = rows[3] - rows[1];
+		frustum.planes[NEAR_PLANE] = rows[3] + rows[2];
+		frustum.planes[FAR_PLANE] = rows[3] - rows[2];
+		for (glm::vec4& plane : frustum.planes)
+			plane /= glm::length(glm::vec3(plane));
+		return frustum;
+	}
+
 	void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
 		float velocity = MovementSpeed * deltaTime;
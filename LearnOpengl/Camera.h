@@ -20,6 +20,26 @@ namespace LOGL
 	const float SENSITIVITY = 0.1f;
 	const float ZOOM = 45.0f;
 
+	// planes as (normal, distance) with normalized normals pointing inside:
+	// dot(normal, p) + distance >= 0 for every point p in the frustum
+	struct Frustum
+	{
+		enum
+		{
+			LEFT,
+			RIGHT,
+			BOTTOM,
+			TOP,
+			NEAR_PLANE,
+			FAR_PLANE,
+			PLANE_COUNT
+		};
+		glm::vec4 planes[PLANE_COUNT];
+
+		// planes of the clip volume of viewProjection, in the space viewProjection transforms from
+		static Frustum fromMatrix(const glm::mat4& viewProjection);
+	};
+
 	class Camera
 	{
 	public:
@@ -48,6 +68,9 @@ namespace LOGL
 
 		glm::mat4 GetViewMatrix();
 
+		// world space planes of what GetViewMatrix() and projection see
+		Frustum GetFrustum(const glm::mat4& projection);
+
 		void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 
 		void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true);
@@ -0,0 +1,15 @@
+#pragma once
+
+// marks a function compiled for AVX2 and FMA in a translation unit built for the SSE2
+// baseline, it may only run after hasAVX2() returned true; MSVC takes the intrinsics as is
+#ifdef __GNUC__
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace LOGL
+{
+    // AVX2 and FMA on the CPU and their registers saved by the OS
+    bool hasAVX2();
+}
@@ -0,0 +1,517 @@
+#include "Culling.h"
+#include "CpuFeatures.h"
+#include "logger.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstring>
+
+namespace LOGL
+{
+	// the frustum broadcast one component per array, abs* are |normal| for the box extent
+	struct CullPlanes
+	{
+		float x[Frustum::PLANE_COUNT];
+		float y[Frustum::PLANE_COUNT];
+		float z[Frustum::PLANE_COUNT];
+		float w[Frustum::PLANE_COUNT];
+		float absX[Frustum::PLANE_COUNT];
+		float absY[Frustum::PLANE_COUNT];
+		float absZ[Frustum::PLANE_COUNT];
+	};
+
+	static CullPlanes splitPlanes(const Frustum& frustum)
+	{
+		CullPlanes planes;
+		for (int i = 0; i < Frustum::PLANE_COUNT; i++)
+		{
+			planes.x[i] = frustum.planes[i].x;
+			planes.y[i] = frustum.planes[i].y;
+			planes.z[i] = frustum.planes[i].z;
+			planes.w[i] = frustum.planes[i].w;
+			planes.absX[i] = std::fabs(frustum.planes[i].x);
+			planes.absY[i] = std::fabs(frustum.planes[i].y);
+			planes.absZ[i] = std::fabs(frustum.planes[i].z);
+		}
+		return planes;
+	}
+
+	// lanes of every set bit of an 8 bit mask in order, and how many there are
+	struct CompactTable
+	{
+		uint8_t lanes[256][8];
+		uint8_t counts[256];
+
+		CompactTable()
+		{
+			for (int mask = 0; mask < 256; mask++)
+			{
+				int count = 0;
+				for (int lane = 0; lane < 8; lane++)
+				{
+					if (mask & (1 << lane))
+						lanes[mask][count++] = (uint8_t)lane;
+				}
+				for (int lane = count; lane < 8; lane++)
+					lanes[mask][lane] = 0;
+				counts[mask] = (uint8_t)count;
+			}
+		}
+	};
+	static const CompactTable compactTable;
+
+	// the kernels write the visible indices of [begin, end) to out and return how many;
+	// stores run up to 8 entries past the count, out needs end - begin + 8 of room
+
+	static size_t cullBoxesScalar(const CullPlanes& planes, const BoundingBoxes& boxes, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < Frustum::PLANE_COUNT && inside; p++)
+			{
+				float distance = planes.x[p] * boxes.centerX[i] + planes.y[p] * boxes.centerY[i] + planes.z[p] * boxes.centerZ[i] + planes.w[p];
+				float radius = planes.absX[p] * boxes.extentX[i] + planes.absY[p] * boxes.extentY[i] + planes.absZ[p] * boxes.extentZ[i];
+				inside = distance + radius >= 0.0f;
+			}
+			out[count] = (uint32_t)i;
+			count += inside;
+		}
+		return count;
+	}
+
+	static size_t cullSpheresScalar(const CullPlanes& planes, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < Frustum::PLANE_COUNT && inside; p++)
+			{
+				float distance = planes.x[p] * spheres.centerX[i] + planes.y[p] * spheres.centerY[i] + planes.z[p] * spheres.centerZ[i] + planes.w[p];
+				inside = distance + spheres.radius[i] >= 0.0f;
+			}
+			out[count] = (uint32_t)i;
+			count += inside;
+		}
+		return count;
+	}
+
+	static inline size_t compactSSE(int mask, size_t base, uint32_t* out)
+	{
+		const uint8_t* lanes = compactTable.lanes[mask];
+		for (int lane = 0; lane < 4; lane++)
+			out[lane] = (uint32_t)base + lanes[lane];
+		return compactTable.counts[mask];
+	}
+
+	static size_t cullBoxesSSE(const CullPlanes& planes, const BoundingBoxes& boxes, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		size_t i = begin;
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+			__m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+			__m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+			__m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+			__m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+			__m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes.x[p])), _mm_mul_ps(cy, _mm_set1_ps(planes.y[p]))),
+					_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes.z[p])), _mm_set1_ps(planes.w[p])));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(planes.absX[p])), _mm_mul_ps(ey, _mm_set1_ps(planes.absY[p]))),
+					_mm_mul_ps(ez, _mm_set1_ps(planes.absZ[p])));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+			}
+			count += compactSSE(_mm_movemask_ps(inside), i, out + count);
+		}
+		return count + cullBoxesScalar(planes, boxes, i, end, out + count);
+	}
+
+	static size_t cullSpheresSSE(const CullPlanes& planes, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		size_t i = begin;
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(&spheres.centerX[i]);
+			__m128 cy = _mm_loadu_ps(&spheres.centerY[i]);
+			__m128 cz = _mm_loadu_ps(&spheres.centerZ[i]);
+			__m128 r = _mm_loadu_ps(&spheres.radius[i]);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes.x[p])), _mm_mul_ps(cy, _mm_set1_ps(planes.y[p]))),
+					_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes.z[p])), _mm_set1_ps(planes.w[p])));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+			}
+			count += compactSSE(_mm_movemask_ps(inside), i, out + count);
+		}
+		return count + cullSpheresScalar(planes, spheres, i, end, out + count);
+	}
+
+	// one unaligned store of all 8 lanes, the lanes of set bits first
+	TARGET_AVX2 static inline size_t compactAVX2(int mask, size_t base, uint32_t* out)
+	{
+		__m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)compactTable.lanes[mask]));
+		_mm256_storeu_si256((__m256i*)out, _mm256_add_epi32(lanes, _mm256_set1_epi32((int)base)));
+		return compactTable.counts[mask];
+	}
+
+	TARGET_AVX2 static size_t cullBoxesAVX2(const CullPlanes& planes, const BoundingBoxes& boxes, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		size_t i = begin;
+		const __m256 zero = _mm256_setzero_ps();
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 cx = _mm256_loadu_ps(&boxes.centerX[i]);
+			__m256 cy = _mm256_loadu_ps(&boxes.centerY[i]);
+			__m256 cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+			__m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+			__m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+			{
+				// distance + radius in one FMA chain
+				__m256 reach = _mm256_fmadd_ps(cx, _mm256_set1_ps(planes.x[p]), _mm256_set1_ps(planes.w[p]));
+				reach = _mm256_fmadd_ps(cy, _mm256_set1_ps(planes.y[p]), reach);
+				reach = _mm256_fmadd_ps(cz, _mm256_set1_ps(planes.z[p]), reach);
+				reach = _mm256_fmadd_ps(ex, _mm256_set1_ps(planes.absX[p]), reach);
+				reach = _mm256_fmadd_ps(ey, _mm256_set1_ps(planes.absY[p]), reach);
+				reach = _mm256_fmadd_ps(ez, _mm256_set1_ps(planes.absZ[p]), reach);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(reach, zero, _CMP_GE_OQ));
+			}
+			count += compactAVX2(_mm256_movemask_ps(inside), i, out + count);
+		}
+		return count + cullBoxesScalar(planes, boxes, i, end, out + count);
+	}
+
+	TARGET_AVX2 static size_t cullSpheresAVX2(const CullPlanes& planes, const BoundingSpheres& spheres, size_t begin, size_t end, uint32_t* out)
+	{
+		size_t count = 0;
+		size_t i = begin;
+		const __m256 zero = _mm256_setzero_ps();
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 cx = _mm256_loadu_ps(&spheres.centerX[i]);
+			__m256 cy = _mm256_loadu_ps(&spheres.centerY[i]);
+			__m256 cz = _mm256_loadu_ps(&spheres.centerZ[i]);
+			__m256 r = _mm256_loadu_ps(&spheres.radius[i]);
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+			{
+				__m256 reach = _mm256_fmadd_ps(cx, _mm256_set1_ps(planes.x[p]), _mm256_add_ps(r, _mm256_set1_ps(planes.w[p])));
+				reach = _mm256_fmadd_ps(cy, _mm256_set1_ps(planes.y[p]), reach);
+				reach = _mm256_fmadd_ps(cz, _mm256_set1_ps(planes.z[p]), reach);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(reach, zero, _CMP_GE_OQ));
+			}
+			count += compactAVX2(_mm256_movemask_ps(inside), i, out + count);
+		}
+		return count + cullSpheresScalar(planes, spheres, i, end, out + count);
+	}
+
+	void BoundingBoxes::add(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 extent = (max - min) * 0.5f;
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		extentX.push_back(extent.x);
+		extentY.push_back(extent.y);
+		extentZ.push_back(extent.z);
+	}
+
+	void BoundingBoxes::add(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max)
+	{
+		// the extent along each world axis is the sum of the transformed half axes' projections
+		glm::vec3 center = glm::vec3(model * glm::vec4((min + max) * 0.5f, 1.0f));
+		glm::vec3 halfSize = (max - min) * 0.5f;
+		glm::vec3 extent = glm::abs(glm::vec3(model[0])) * halfSize.x + glm::abs(glm::vec3(model[1])) * halfSize.y + glm::abs(glm::vec3(model[2])) * halfSize.z;
+		add(center - extent, center + extent);
+	}
+
+	void BoundingBoxes::clear()
+	{
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		extentX.clear();
+		extentY.clear();
+		extentZ.clear();
+	}
+
+	size_t BoundingBoxes::size() const
+	{
+		return centerX.size();
+	}
+
+	void BoundingSpheres::add(const glm::vec3& center, float r)
+	{
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		radius.push_back(r);
+	}
+
+	void BoundingSpheres::clear()
+	{
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+	}
+
+	size_t BoundingSpheres::size() const
+	{
+		return centerX.size();
+	}
+
+	FrustumCuller::FrustumCuller() : m_ChunkCount(0), m_NextChunk(0), m_DoneChunks(0)
+	{
+	}
+
+	FrustumCuller::~FrustumCuller()
+	{
+		shutdown();
+	}
+
+	void FrustumCuller::init(unsigned int threadCount)
+	{
+		shutdown();
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		m_Running = true;
+		for (unsigned int i = 1; i < threadCount; i++)
+			m_Threads.push_back(std::thread(&FrustumCuller::run, this));
+	}
+
+	void FrustumCuller::shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Running = false;
+		}
+		m_Wake.notify_all();
+		for (std::thread& thread : m_Threads)
+			thread.join();
+		m_Threads.clear();
+	}
+
+	void FrustumCuller::run()
+	{
+		uint64_t generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Wake.wait(lock, [&] { return !m_Running || m_Generation != generation; });
+				if (!m_Running)
+					return;
+				generation = m_Generation;
+				// woken after the calling thread took every chunk, the job may be gone already
+				if (m_NextChunk >= m_ChunkCount)
+					continue;
+				m_Active++;
+				m_Stats.threads++;
+			}
+			work();
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Active--;
+			}
+			m_Finished.notify_one();
+		}
+	}
+
+	void FrustumCuller::work()
+	{
+		size_t chunkCount = m_ChunkCount;
+		for (size_t chunk = m_NextChunk++; chunk < chunkCount; chunk = m_NextChunk++)
+		{
+			cullChunk(chunk);
+			m_DoneChunks++;
+		}
+	}
+
+	void FrustumCuller::cullChunk(size_t chunk)
+	{
+		static const bool avx2 = hasAVX2();
+		size_t begin = chunk * CULL_CHUNK_SIZE;
+		size_t end = std::min(begin + CULL_CHUNK_SIZE, m_Count);
+		uint32_t* out = m_Chunks[chunk].visible.data();
+		CullPlanes planes = splitPlanes(m_Frustum);
+
+		size_t count;
+		if (m_Boxes)
+		{
+			if (!m_SIMD)
+				count = cullBoxesScalar(planes, *m_Boxes, begin, end, out);
+			else if (avx2)
+				count = cullBoxesAVX2(planes, *m_Boxes, begin, end, out);
+			else
+				count = cullBoxesSSE(planes, *m_Boxes, begin, end, out);
+		}
+		else
+		{
+			if (!m_SIMD)
+				count = cullSpheresScalar(planes, *m_Spheres, begin, end, out);
+			else if (avx2)
+				count = cullSpheresAVX2(planes, *m_Spheres, begin, end, out);
+			else
+				count = cullSpheresSSE(planes, *m_Spheres, begin, end, out);
+		}
+		m_Chunks[chunk].count = count;
+	}
+
+	void FrustumCuller::dispatch(size_t count, std::vector<uint32_t>& visible)
+	{
+		auto start = std::chrono::steady_clock::now();
+		size_t chunkCount = (count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+		if (m_Chunks.size() < chunkCount)
+			m_Chunks.resize(chunkCount);
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			m_Chunks[chunk].visible.resize(CULL_CHUNK_SIZE + 8);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Count = count;
+			m_ChunkCount = chunkCount;
+			m_DoneChunks = 0;
+			m_NextChunk = 0;
+			m_Stats.threads = 1;
+			if (chunkCount > 1 && !m_Threads.empty())
+				m_Generation++;
+		}
+		m_Wake.notify_all();
+		work();
+		{
+			// workers that took a chunk still have to finish it
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Finished.wait(lock, [this] { return m_Active == 0 && m_DoneChunks == m_ChunkCount; });
+		}
+
+		size_t total = 0;
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			total += m_Chunks[chunk].count;
+		visible.resize(total);
+		size_t offset = 0;
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			if (m_Chunks[chunk].count)
+				memcpy(visible.data() + offset, m_Chunks[chunk].visible.data(), m_Chunks[chunk].count * sizeof(uint32_t));
+			offset += m_Chunks[chunk].count;
+		}
+
+		m_Stats.tested = count;
+		m_Stats.visible = total;
+		m_Stats.chunks = chunkCount;
+		m_Stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void FrustumCuller::cull(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible)
+	{
+		m_Frustum = frustum;
+		m_Boxes = &boxes;
+		m_Spheres = nullptr;
+		dispatch(boxes.size(), visible);
+	}
+
+	void FrustumCuller::cull(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible)
+	{
+		m_Frustum = frustum;
+		m_Boxes = nullptr;
+		m_Spheres = &spheres;
+		dispatch(spheres.size(), visible);
+	}
+
+	void FrustumCuller::setSIMD(bool enabled)
+	{
+		m_SIMD = enabled;
+	}
+
+	bool FrustumCuller::getSIMD() const
+	{
+		return m_SIMD;
+	}
+
+	const CullStats& FrustumCuller::getStats() const
+	{
+		return m_Stats;
+	}
+
+	bool benchmarkCulling(size_t count)
+	{
+		if (!count)
+			return false;
+
+		// objects spread through a cube around the camera, about a tenth of them visible
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+		BoundingBoxes boxes;
+		BoundingSpheres spheres;
+		for (size_t i = 0; i < count; i++)
+		{
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 extent(size(random), size(random), size(random));
+			boxes.add(center - extent, center + extent);
+			spheres.add(center, glm::length(extent));
+		}
+		Camera camera(glm::vec3(0.0f, 0.0f, 0.0f));
+		Frustum frustum = camera.GetFrustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 300.0f));
+
+		unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+		FrustumCuller single, threaded;
+		single.init(1);
+		threaded.init(threadCount);
+		struct Variant
+		{
+			const char* name;
+			FrustumCuller* culler;
+			bool simd;
+		};
+		Variant variants[] = { { "scalar, 1 thread", &single, false }, { "SIMD, 1 thread", &single, true }, { "SIMD, all threads", &threaded, true } };
+
+		bool agree = true;
+		for (int shape = 0; shape < 2; shape++)
+		{
+			std::vector<uint32_t> reference;
+			for (const Variant& variant : variants)
+			{
+				variant.culler->setSIMD(variant.simd);
+				std::vector<uint32_t> visible;
+				double milliseconds = 0.0;
+				// frame -1 faults in the chunk buffers and isn't counted
+				for (int frame = -1; frame < CULL_BENCH_FRAMES; frame++)
+				{
+					if (shape == 0)
+						variant.culler->cull(frustum, boxes, visible);
+					else
+						variant.culler->cull(frustum, spheres, visible);
+					if (frame >= 0)
+						milliseconds += variant.culler->getStats().milliseconds;
+				}
+				if (reference.empty())
+					reference = visible;
+				bool same = visible == reference;
+				agree = agree && same;
+				LOGL::log("bool benchmarkCulling(size_t count) -> %-7s %-18s %8.3f ms  %6.2f ns/object  %d visible%s",
+					shape == 0 ? "boxes" : "spheres", variant.name, milliseconds / CULL_BENCH_FRAMES, milliseconds * 1e6 / ((double)CULL_BENCH_FRAMES * count),
+					(int)visible.size(), same ? "" : "  DIFFERS");
+			}
+		}
+		LOGL::log("bool benchmarkCulling(size_t count) -> %d objects, %u threads, %s", (int)count, threadCount, hasAVX2() ? "AVX2" : "SSE");
+		return agree;
+	}
+}
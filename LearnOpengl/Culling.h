@@ -0,0 +1,112 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "Camera.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+// objects a worker culls at a time, a multiple of 8
+#define CULL_CHUNK_SIZE 16384
+// frames every variant of benchmarkCulling is timed over
+#define CULL_BENCH_FRAMES 10
+
+namespace LOGL
+{
+    // world space AABBs as center and half size, one array per component so
+    // SIMD reads a component of 8 neighbouring boxes with one load
+    struct BoundingBoxes
+    {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+
+        void add(const glm::vec3& min, const glm::vec3& max);
+        // the box around the model space box min, max after model
+        void add(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max);
+        void clear();
+        size_t size() const;
+    };
+
+    struct BoundingSpheres
+    {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> radius;
+
+        void add(const glm::vec3& center, float radius);
+        void clear();
+        size_t size() const;
+    };
+
+    struct CullStats
+    {
+        size_t tested = 0;
+        size_t visible = 0;
+        // chunks the last cull was split into and threads that worked on them
+        size_t chunks = 0;
+        unsigned int threads = 0;
+        double milliseconds = 0.0;
+    };
+
+    // tests bounds against a frustum on the calling thread and a pool of workers that
+    // sleep between calls; AVX2 takes 8 objects per step, SSE 4 without it, and the indices
+    // of the ones at least partly inside are written out compacted and ascending
+    class FrustumCuller
+    {
+    public:
+        FrustumCuller();
+        ~FrustumCuller();
+        // threadCount includes the calling thread, 0 takes every hardware thread
+        void init(unsigned int threadCount = 0);
+        void shutdown();
+
+        void cull(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible);
+        void cull(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+
+        // false tests one object at a time, the reference the SIMD paths are checked against
+        void setSIMD(bool enabled);
+        bool getSIMD() const;
+        const CullStats& getStats() const;
+    private:
+        struct Chunk
+        {
+            std::vector<uint32_t> visible;
+            size_t count = 0;
+        };
+
+        void run();
+        // takes chunks until none are left
+        void work();
+        void cullChunk(size_t chunk);
+        void dispatch(size_t count, std::vector<uint32_t>& visible);
+
+        std::vector<std::thread> m_Threads;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        std::condition_variable m_Finished;
+        bool m_Running = false;
+        // bumped for every cull the workers take part in
+        uint64_t m_Generation = 0;
+        // workers inside work(), the next cull waits for them
+        int m_Active = 0;
+
+        // the job of the current cull, written before m_NextChunk is reset
+        Frustum m_Frustum;
+        const BoundingBoxes* m_Boxes = nullptr;
+        const BoundingSpheres* m_Spheres = nullptr;
+        size_t m_Count = 0;
+        std::atomic<size_t> m_ChunkCount;
+        std::atomic<size_t> m_NextChunk;
+        std::atomic<size_t> m_DoneChunks;
+        std::vector<Chunk> m_Chunks;
+
+        bool m_SIMD = true;
+        CullStats m_Stats;
+    };
+
+    // culls count random boxes and spheres with one thread and every thread, scalar and SIMD,
+    // checks that all variants agree and logs ns per object
+    bool benchmarkCulling(size_t count);
+}
@@ -0,0 +1,235 @@
+#include "DeferredLightning.h"
+#include "MaterialTable.h"
+#include "GLState.h"
+#include <cstddef>
+
+namespace LOGL
+{
+	DeferredLightning::DeferredLightning()
+	{
+	}
+
+	void DeferredLightning::init(BasicLightning& lights)
+	{
+		m_Lights = &lights;
+
+		// compiled in the background, samplers are bound once isReady() finds them done
+		ShaderDefines geometryDefines;
+		geometryDefines["MAX_MATERIALS"] = std::to_string(MAX_MATERIALS);
+		geometryDefines["MATERIAL_ARRAY_COUNT"] = std::to_string(MaterialTable::getArrayCount());
+		m_GeometryShader = Shader::getVariant("shaders/basic_lightningvs.glsl", "shaders/deferred_gbufferfs.glsl", geometryDefines, true);
+		m_DepthShader = Shader::getVariant("shaders/deferred_dirvs.glsl", "shaders/deferred_depthfs.glsl", ShaderDefines(), true);
+		m_DirShader = Shader::getVariant("shaders/deferred_dirvs.glsl", "shaders/deferred_lightfs.glsl", ShaderDefines(), true);
+		m_PointShader = Shader::getVariant("shaders/deferred_pointvs.glsl", "shaders/deferred_lightfs.glsl", ShaderDefines(), true);
+
+		// unit cube, light volumes are scaled by the light radius
+		float cube[] = {
+			-0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,  0.5f, -0.5f,
+			-0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f,
+			-0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,
+			 0.5f,  0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,
+			-0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f,
+			-0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f
+		};
+
+		glGenBuffers(1, &m_CubeBuffer);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_CubeBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
+
+		m_VolumeCapacity = 64;
+		glGenBuffers(1, &m_VolumeBuffer);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_VolumeBuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_VolumeCapacity * sizeof(LightVolume), NULL, GL_STREAM_DRAW);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenVertexArrays(1, &m_DirVAO);
+		glGenVertexArrays(1, &m_PointVAO);
+		GLState.bindVertexArray(m_PointVAO);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_CubeBuffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		GLState.bindVertexArray(0);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	bool DeferredLightning::isReady()
+	{
+		if (m_Ready)
+			return true;
+
+		for (Shader* shader : { m_GeometryShader.get(), m_DepthShader.get(), m_DirShader.get(), m_PointShader.get() })
+			if (!shader->isReady())
+				return false;
+
+		MaterialTable::setupShader(*m_GeometryShader);
+
+		m_DepthShader->use();
+		m_DepthShader->setInt("gDepth", GBUFFER_DEPTH_UNIT);
+
+		for (Shader* shader : { m_DirShader.get(), m_PointShader.get() })
+		{
+			shader->use();
+			shader->setInt("gAlbedo", GBUFFER_ALBEDO_UNIT);
+			shader->setInt("gSpecular", GBUFFER_SPECULAR_UNIT);
+			shader->setInt("gNormal", GBUFFER_NORMAL_UNIT);
+			shader->setInt("gDepth", GBUFFER_DEPTH_UNIT);
+			shader->setInt("lightData", LIGHT_DATA_UNIT);
+		}
+
+		m_Ready = true;
+		return true;
+	}
+
+	void DeferredLightning::createGBuffer(int width, int height)
+	{
+		if (m_GBuffer)
+		{
+			GLuint textures[] = { m_Albedo, m_Specular, m_Normal, m_Depth };
+			GLState.deleteTextures(4, textures);
+			glDeleteFramebuffers(1, &m_GBuffer);
+		}
+		m_Width = width;
+		m_Height = height;
+
+		auto createTarget = [width, height](GLint internalFormat, GLenum format, GLenum type) {
+			GLuint texture;
+			glGenTextures(1, &texture);
+			GLState.bindTexture(GL_TEXTURE_2D, texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			return texture;
+		};
+		m_Albedo = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+		m_Specular = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+		m_Normal = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+		m_Depth = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+		GLState.bindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &m_GBuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Albedo, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_Specular, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_Normal, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_Depth, 0);
+		GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+		glDrawBuffers(3, drawBuffers);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			LOGL::error("void DeferredLightning::createGBuffer(int width, int height) -> G-buffer is incomplete");
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void DeferredLightning::use(int width, int height)
+	{
+		// used before isReady() said so, Shader::use() waits for the driver
+		if (!m_Ready)
+		{
+			for (Shader* shader : { m_GeometryShader.get(), m_DepthShader.get(), m_DirShader.get(), m_PointShader.get() })
+				shader->use();
+			isReady();
+		}
+
+		// lighting is resolved into whatever framebuffer the scene was going to
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_TargetFramebuffer);
+
+		if (width != m_Width || height != m_Height)
+			createGBuffer(width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		m_GeometryShader->use();
+	}
+
+	void DeferredLightning::setModelMat(glm::mat4& model, GLint material)
+	{
+		setInstanceAttribs(model, material);
+	}
+
+	void DeferredLightning::resolve()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_TargetFramebuffer);
+
+		GLState.bindTextureUnit(GBUFFER_ALBEDO_UNIT, GL_TEXTURE_2D, m_Albedo);
+		GLState.bindTextureUnit(GBUFFER_SPECULAR_UNIT, GL_TEXTURE_2D, m_Specular);
+		GLState.bindTextureUnit(GBUFFER_NORMAL_UNIT, GL_TEXTURE_2D, m_Normal);
+		GLState.bindTextureUnit(GBUFFER_DEPTH_UNIT, GL_TEXTURE_2D, m_Depth);
+
+		GLState.bindVertexArray(m_DirVAO);
+		GLState.depthFunc(GL_ALWAYS);
+		m_DepthShader->use();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		GLState.depthFunc(GL_LESS);
+
+		// directional lights first so they take the front of the instance buffer
+		const std::vector<LightSourceStd140>& lights = m_Lights->getLightData();
+		m_Volumes.clear();
+		for (int i = 0; i < (int)lights.size(); i++)
+			if (lights[i].isDirLight)
+				m_Volumes.push_back({ glm::vec4(0.0f), i });
+		size_t dirCount = m_Volumes.size();
+		for (int i = 0; i < (int)lights.size(); i++)
+		{
+			float radius = getLightRadius(lights[i]);
+			if (!lights[i].isDirLight && radius > 0.0f)
+				m_Volumes.push_back({ glm::vec4(lights[i].position, radius), i });
+		}
+		if (m_Volumes.empty())
+			return;
+
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_VolumeBuffer);
+		if (m_Volumes.size() > m_VolumeCapacity)
+		{
+			m_VolumeCapacity = m_Volumes.size() * 2;
+			glBufferData(GL_ARRAY_BUFFER, m_VolumeCapacity * sizeof(LightVolume), NULL, GL_STREAM_DRAW);
+		}
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_Volumes.size() * sizeof(LightVolume), m_Volumes.data());
+
+		m_Lights->uploadLights();
+		GLState.bindTextureUnit(LIGHT_DATA_UNIT, GL_TEXTURE_BUFFER, m_Lights->getLightDataTexture());
+
+		GLState.depthMask(GL_FALSE);
+		GLState.disable(GL_DEPTH_TEST);
+		GLState.enable(GL_BLEND);
+		GLState.blendFunc(GL_ONE, GL_ONE);
+
+		if (dirCount > 0)
+		{
+			GLState.bindVertexArray(m_DirVAO);
+			glVertexAttribIPointer(4, 1, GL_INT, sizeof(LightVolume), (void*)offsetof(LightVolume, index));
+			glVertexAttribDivisor(4, 1);
+			glEnableVertexAttribArray(4);
+
+			m_DirShader->use();
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 3, (GLsizei)dirCount);
+		}
+
+		if (m_Volumes.size() > dirCount)
+		{
+			size_t base = dirCount * sizeof(LightVolume);
+			GLState.bindVertexArray(m_PointVAO);
+			glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(LightVolume), (void*)(base + offsetof(LightVolume, sphere)));
+			glVertexAttribDivisor(3, 1);
+			glEnableVertexAttribArray(3);
+			glVertexAttribIPointer(4, 1, GL_INT, sizeof(LightVolume), (void*)(base + offsetof(LightVolume, index)));
+			glVertexAttribDivisor(4, 1);
+			glEnableVertexAttribArray(4);
+
+			// back faces only so the volume still shades when the camera is inside it
+			GLState.enable(GL_CULL_FACE);
+			GLState.cullFace(GL_FRONT);
+			GLState.enable(GL_DEPTH_CLAMP);
+			m_PointShader->use();
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)(m_Volumes.size() - dirCount));
+			GLState.disable(GL_DEPTH_CLAMP);
+			GLState.cullFace(GL_BACK);
+			GLState.disable(GL_CULL_FACE);
+		}
+
+		GLState.disable(GL_BLEND);
+		GLState.enable(GL_DEPTH_TEST);
+		GLState.depthMask(GL_TRUE);
+	}
+}
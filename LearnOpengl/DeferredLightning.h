@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Shader.h"
+#include "BasicLightning.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <memory>
+
+// units 2-4 hold BasicLightning's light buffers
+#define GBUFFER_ALBEDO_UNIT 0
+#define GBUFFER_SPECULAR_UNIT 1
+#define GBUFFER_NORMAL_UNIT 5
+#define GBUFFER_DEPTH_UNIT 6
+
+namespace LOGL
+{
+    // per instance data of a light volume
+    struct LightVolume
+    {
+        glm::vec4 sphere;
+        GLint index;
+    };
+
+    // deferred alternative to BasicLightning::use(), reads the same lights:
+    // use() renders geometry into the G-buffer, resolve() draws one volume per light
+    class DeferredLightning
+    {
+    public:
+        DeferredLightning();
+        void init(BasicLightning& lights);
+        // false while the programs are still compiling, render forward until then
+        bool isReady();
+        void use(int width, int height);
+        void setModelMat(glm::mat4& model, GLint material = 0);
+        void resolve();
+    private:
+        void createGBuffer(int width, int height);
+
+        BasicLightning* m_Lights = nullptr;
+        std::shared_ptr<Shader> m_GeometryShader;
+        std::shared_ptr<Shader> m_DepthShader;
+        std::shared_ptr<Shader> m_DirShader;
+        std::shared_ptr<Shader> m_PointShader;
+        bool m_Ready = false;
+
+        int m_Width = 0;
+        int m_Height = 0;
+        GLint m_TargetFramebuffer = 0;
+        GLuint m_GBuffer = 0;
+        GLuint m_Albedo = 0;
+        GLuint m_Specular = 0;
+        GLuint m_Normal = 0;
+        GLuint m_Depth = 0;
+
+        std::vector<LightVolume> m_Volumes;
+        GLuint m_VolumeBuffer = 0;
+        size_t m_VolumeCapacity = 0;
+        GLuint m_DirVAO = 0;
+        GLuint m_PointVAO = 0;
+        GLuint m_CubeBuffer = 0;
+    };
+}
@@ -0,0 +1,35 @@
+#include "FrameConstants.h"
+#include "GLState.h"
+
+namespace LOGL
+{
+	FrameConstants::FrameConstants()
+	{
+	}
+
+	void FrameConstants::init()
+	{
+		glGenBuffers(1, &m_UBO);
+		GLState.bindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstantsStd140), NULL, GL_DYNAMIC_DRAW);
+		GLState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		GLState.bindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, m_UBO);
+	}
+
+	void FrameConstants::update(Camera& camera, glm::mat4& proj, float time, int width, int height)
+	{
+		m_Data.view = camera.GetViewMatrix();
+		m_Data.projection = proj;
+		m_Data.viewProj = proj * m_Data.view;
+		m_Data.invViewProj = glm::inverse(m_Data.viewProj);
+		m_Data.viewPos = camera.Position;
+		m_Data.time = time;
+		m_Data.viewportSize = glm::vec2((float)width, (float)height);
+
+		// left bound, next frame's bind is elided
+		GLState.bindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstantsStd140), &m_Data);
+		GLState.bindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, m_UBO);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "Camera.h"
+
+#define FRAME_CONSTANTS_BINDING 0
+
+namespace LOGL
+{
+    // std140 layout of the FrameConstants uniform block shared by every shader
+    struct FrameConstantsStd140
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProj;
+        glm::mat4 invViewProj;
+        glm::vec3 viewPos;
+        float time;
+        glm::vec2 viewportSize;
+        float padding[2];
+    };
+    static_assert(sizeof(FrameConstantsStd140) == 288, "FrameConstantsStd140 must match std140 layout");
+
+    class FrameConstants
+    {
+    public:
+        FrameConstants();
+        void init();
+        // fills the block once per frame, every program reads it from FRAME_CONSTANTS_BINDING
+        void update(Camera& camera, glm::mat4& proj, float time, int width, int height);
+    private:
+        GLuint m_UBO = 0;
+        FrameConstantsStd140 m_Data = {};
+    };
+}
@@ -0,0 +1,76 @@
+#include "GLExtensions.h"
+#include "logger.h"
+#include <cstring>
+
+namespace LOGL
+{
+	GLExtensions GLExt;
+
+	bool hasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension && strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	void loadExtensions(GLADloadproc load)
+	{
+		if (hasExtension("GL_ARB_get_program_binary"))
+		{
+			GLExt.GetProgramBinary = (PFNLOGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+			GLExt.ProgramBinary = (PFNLOGLPROGRAMBINARYPROC)load("glProgramBinary");
+			GLExt.ProgramParameteri = (PFNLOGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			if (formats > 0)
+			{
+				std::vector<GLint> values(formats);
+				glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, values.data());
+				GLExt.ProgramBinaryFormats.assign(values.begin(), values.end());
+			}
+			GLExt.ARB_get_program_binary = GLExt.GetProgramBinary && GLExt.ProgramBinary && GLExt.ProgramParameteri && formats > 0;
+		}
+
+		if (hasExtension("GL_KHR_parallel_shader_compile"))
+			GLExt.MaxShaderCompilerThreads = (PFNLOGLMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsKHR");
+		else if (hasExtension("GL_ARB_parallel_shader_compile"))
+			GLExt.MaxShaderCompilerThreads = (PFNLOGLMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsARB");
+		GLExt.KHR_parallel_shader_compile = GLExt.MaxShaderCompilerThreads != nullptr;
+		// let the driver pick the thread count
+		if (GLExt.KHR_parallel_shader_compile)
+			GLExt.MaxShaderCompilerThreads(0xFFFFFFFF);
+
+		GLExt.ARB_pipeline_statistics_query = hasExtension("GL_ARB_pipeline_statistics_query");
+
+		GLExt.EXT_texture_compression_s3tc = hasExtension("GL_EXT_texture_compression_s3tc");
+		GLExt.ARB_texture_compression_bptc = hasExtension("GL_ARB_texture_compression_bptc");
+
+		if (hasExtension("GL_ARB_buffer_storage"))
+			GLExt.BufferStorage = (PFNLOGLBUFFERSTORAGEPROC)load("glBufferStorage");
+		GLExt.ARB_buffer_storage = GLExt.BufferStorage != nullptr;
+
+		if (hasExtension("GL_ARB_copy_image"))
+			GLExt.CopyImageSubData = (PFNLOGLCOPYIMAGESUBDATAPROC)load("glCopyImageSubData");
+		GLExt.ARB_copy_image = GLExt.CopyImageSubData != nullptr;
+
+		if (hasExtension("GL_ARB_multi_draw_indirect") && hasExtension("GL_ARB_draw_indirect") && hasExtension("GL_ARB_base_instance"))
+			GLExt.MultiDrawElementsIndirect = (PFNLOGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+		GLExt.ARB_multi_draw_indirect = GLExt.MultiDrawElementsIndirect != nullptr;
+
+		LOGL::log("GL_ARB_get_program_binary: %s", GLExt.ARB_get_program_binary ? "yes" : "no");
+		LOGL::log("GL_KHR_parallel_shader_compile: %s", GLExt.KHR_parallel_shader_compile ? "yes" : "no");
+		LOGL::log("GL_ARB_pipeline_statistics_query: %s", GLExt.ARB_pipeline_statistics_query ? "yes" : "no");
+		LOGL::log("GL_EXT_texture_compression_s3tc: %s", GLExt.EXT_texture_compression_s3tc ? "yes" : "no");
+		LOGL::log("GL_ARB_texture_compression_bptc: %s", GLExt.ARB_texture_compression_bptc ? "yes" : "no");
+		LOGL::log("GL_ARB_buffer_storage: %s", GLExt.ARB_buffer_storage ? "yes" : "no");
+		LOGL::log("GL_ARB_copy_image: %s", GLExt.ARB_copy_image ? "yes" : "no");
+		LOGL::log("GL_ARB_multi_draw_indirect: %s", GLExt.ARB_multi_draw_indirect ? "yes" : "no");
+	}
+}
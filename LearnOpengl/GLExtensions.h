@@ -0,0 +1,103 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <vector>
+
+// glad is generated for core 3.3 only, entry points and enums of newer
+// functionality are loaded here when the driver exposes them
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_FORMATS
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_VERTEX_SHADER_INVOCATIONS_ARB
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB 0x82F0
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+namespace LOGL
+{
+    typedef void (APIENTRYP PFNLOGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP PFNLOGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP PFNLOGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP PFNLOGLMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+    typedef void (APIENTRYP PFNLOGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    typedef void (APIENTRYP PFNLOGLCOPYIMAGESUBDATAPROC)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+        GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth);
+    typedef void (APIENTRYP PFNLOGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+    struct GLExtensions
+    {
+        // GL_ARB_get_program_binary, core in 4.1
+        bool ARB_get_program_binary = false;
+        PFNLOGLGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+        PFNLOGLPROGRAMBINARYPROC ProgramBinary = nullptr;
+        PFNLOGLPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+        // GL_PROGRAM_BINARY_FORMATS, glProgramBinary accepts no others
+        std::vector<GLenum> ProgramBinaryFormats;
+
+        // GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile,
+        // compile and link return at once and GL_COMPLETION_STATUS_KHR can be polled
+        bool KHR_parallel_shader_compile = false;
+        PFNLOGLMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads = nullptr;
+
+        // GL_ARB_pipeline_statistics_query, new query targets for glBeginQuery only
+        bool ARB_pipeline_statistics_query = false;
+
+        // GL_EXT_texture_compression_s3tc, BC1 and BC3 uploads; BC5 (RGTC) is core
+        bool EXT_texture_compression_s3tc = false;
+        // GL_ARB_texture_compression_bptc, core in 4.2; BC7 uploads
+        bool ARB_texture_compression_bptc = false;
+
+        // GL_ARB_buffer_storage, core in 4.4; immutable buffers that stay mapped while in use
+        bool ARB_buffer_storage = false;
+        PFNLOGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+
+        // GL_ARB_copy_image, core in 4.3; texel copies between textures without a framebuffer or readback
+        bool ARB_copy_image = false;
+        PFNLOGLCOPYIMAGESUBDATAPROC CopyImageSubData = nullptr;
+
+        // GL_ARB_multi_draw_indirect, core in 4.3; only set together with GL_ARB_draw_indirect (4.0)
+        // and GL_ARB_base_instance (4.2), without the latter baseInstance of every command must be 0
+        bool ARB_multi_draw_indirect = false;
+        PFNLOGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+    };
+
+    extern GLExtensions GLExt;
+
+    // call once after gladLoadGLLoader with the same loader
+    void loadExtensions(GLADloadproc load);
+
+    bool hasExtension(const char* name);
+}
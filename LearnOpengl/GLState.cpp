@@ -0,0 +1,396 @@
+#include "GLState.h"
+#include "logger.h"
+
+// shadow value that never matches, the next call always reaches the driver
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu
+
+namespace LOGL
+{
+	GLStateCache GLState;
+
+	static const GLenum BUFFER_TARGETS[] = { GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_TEXTURE_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER,
+		GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER };
+	static const GLenum BUFFER_BINDINGS[] = { GL_ARRAY_BUFFER_BINDING, GL_UNIFORM_BUFFER_BINDING, GL_TEXTURE_BUFFER, GL_PIXEL_PACK_BUFFER_BINDING,
+		GL_PIXEL_UNPACK_BUFFER_BINDING, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER };
+	static const GLenum TEXTURE_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BUFFER, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D };
+	static const GLenum TEXTURE_BINDINGS[] = { GL_TEXTURE_BINDING_2D, GL_TEXTURE_BINDING_2D_ARRAY, GL_TEXTURE_BINDING_BUFFER, GL_TEXTURE_BINDING_CUBE_MAP,
+		GL_TEXTURE_BINDING_3D };
+	static const GLenum CAPS[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_DEPTH_CLAMP, GL_SCISSOR_TEST, GL_STENCIL_TEST };
+
+	GLStateCache::GLStateCache()
+	{
+#ifdef _DEBUG
+		m_Validate = true;
+#else
+		m_Validate = false;
+#endif
+		invalidate();
+	}
+
+	int GLStateCache::bufferSlot(GLenum target) const
+	{
+		for (int i = 0; i < BUFFER_TARGET_COUNT; i++)
+		{
+			if (BUFFER_TARGETS[i] == target)
+				return i;
+		}
+		return -1;
+	}
+
+	int GLStateCache::textureSlot(GLenum target) const
+	{
+		for (int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+		{
+			if (TEXTURE_TARGETS[i] == target)
+				return i;
+		}
+		return -1;
+	}
+
+	int GLStateCache::capSlot(GLenum cap) const
+	{
+		for (int i = 0; i < CAP_COUNT; i++)
+		{
+			if (CAPS[i] == cap)
+				return i;
+		}
+		return -1;
+	}
+
+	GLuint GLStateCache::query(GLenum pname) const
+	{
+		GLint value = 0;
+		glGetIntegerv(pname, &value);
+		return (GLuint)value;
+	}
+
+	bool GLStateCache::elide(bool same, GLuint shadow, GLuint actual, const char* what)
+	{
+		if (same && m_Validate && shadow != actual)
+		{
+			m_Frame.mismatches++;
+			LOGL::error("bool GLStateCache::elide(bool same, GLuint shadow, GLuint actual, const char* what) -> %s is %u, the shadow says %u", what, actual, shadow);
+			same = false;
+		}
+
+		if (same)
+			m_Frame.elided++;
+		else
+			m_Frame.calls++;
+		return same;
+	}
+
+	void GLStateCache::useProgram(GLuint program)
+	{
+		if (elide(m_Program == program, m_Program, m_Validate ? query(GL_CURRENT_PROGRAM) : 0, "GL_CURRENT_PROGRAM"))
+			return;
+		glUseProgram(program);
+		m_Program = program;
+	}
+
+	GLuint GLStateCache::getProgram()
+	{
+		if (m_Program == GL_STATE_UNKNOWN)
+			m_Program = query(GL_CURRENT_PROGRAM);
+		return m_Program;
+	}
+
+	void GLStateCache::bindVertexArray(GLuint vao)
+	{
+		if (elide(m_VertexArray == vao, m_VertexArray, m_Validate ? query(GL_VERTEX_ARRAY_BINDING) : 0, "GL_VERTEX_ARRAY_BINDING"))
+			return;
+		glBindVertexArray(vao);
+		m_VertexArray = vao;
+	}
+
+	void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+	{
+		int slot = bufferSlot(target);
+		if (slot < 0)
+		{
+			m_Frame.calls++;
+			glBindBuffer(target, buffer);
+			return;
+		}
+
+		if (elide(m_Buffers[slot] == buffer, m_Buffers[slot], m_Validate ? query(BUFFER_BINDINGS[slot]) : 0, "buffer binding"))
+			return;
+		glBindBuffer(target, buffer);
+		m_Buffers[slot] = buffer;
+	}
+
+	void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		int slot = bufferSlot(target);
+		if (target != GL_UNIFORM_BUFFER || index >= GL_STATE_UNIFORM_BINDINGS)
+		{
+			m_Frame.calls++;
+			glBindBufferBase(target, index, buffer);
+			if (slot >= 0)
+				m_Buffers[slot] = buffer;
+			return;
+		}
+
+		GLint actual = 0;
+		if (m_Validate)
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, index, &actual);
+		if (elide(m_UniformBindings[index] == buffer, m_UniformBindings[index], (GLuint)actual, "GL_UNIFORM_BUFFER_BINDING"))
+			return;
+		glBindBufferBase(target, index, buffer);
+		m_UniformBindings[index] = buffer;
+		m_Buffers[slot] = buffer;
+	}
+
+	void GLStateCache::activeTexture(GLenum unit)
+	{
+		if (elide(m_ActiveTexture == unit, m_ActiveTexture, m_Validate ? query(GL_ACTIVE_TEXTURE) : 0, "GL_ACTIVE_TEXTURE"))
+			return;
+		glActiveTexture(unit);
+		m_ActiveTexture = unit;
+	}
+
+	void GLStateCache::bindTexture(GLenum target, GLuint texture)
+	{
+		GLuint unit = m_ActiveTexture - GL_TEXTURE0;
+		int slot = textureSlot(target);
+		if (m_ActiveTexture == GL_STATE_UNKNOWN || unit >= GL_STATE_TEXTURE_UNITS || slot < 0)
+		{
+			m_Frame.calls++;
+			glBindTexture(target, texture);
+			return;
+		}
+
+		GLuint& shadow = m_Textures[unit][slot];
+		if (elide(shadow == texture, shadow, m_Validate ? query(TEXTURE_BINDINGS[slot]) : 0, "texture binding"))
+			return;
+		glBindTexture(target, texture);
+		shadow = texture;
+	}
+
+	void GLStateCache::bindTextureUnit(GLuint unit, GLenum target, GLuint texture)
+	{
+		int slot = textureSlot(target);
+		if (unit < GL_STATE_TEXTURE_UNITS && slot >= 0 && m_Textures[unit][slot] == texture)
+		{
+			GLuint actual = 0;
+			if (m_Validate)
+			{
+				GLint active = 0;
+				glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+				glActiveTexture(GL_TEXTURE0 + unit);
+				actual = query(TEXTURE_BINDINGS[slot]);
+				glActiveTexture(active);
+			}
+			if (elide(true, texture, actual, "texture binding"))
+				return;
+			m_Textures[unit][slot] = GL_STATE_UNKNOWN;
+		}
+
+		activeTexture(GL_TEXTURE0 + unit);
+		bindTexture(target, texture);
+	}
+
+	void GLStateCache::setCap(GLenum cap, bool enabled)
+	{
+		int slot = capSlot(cap);
+		GLuint value = enabled ? 1 : 0;
+		if (slot >= 0 && elide(m_Caps[slot] == value, m_Caps[slot], m_Validate ? (GLuint)glIsEnabled(cap) : 0, "capability"))
+			return;
+
+		if (slot < 0)
+			m_Frame.calls++;
+		else
+			m_Caps[slot] = value;
+		if (enabled)
+			glEnable(cap);
+		else
+			glDisable(cap);
+	}
+
+	void GLStateCache::enable(GLenum cap)
+	{
+		setCap(cap, true);
+	}
+
+	void GLStateCache::disable(GLenum cap)
+	{
+		setCap(cap, false);
+	}
+
+	void GLStateCache::depthMask(GLboolean flag)
+	{
+		if (elide(m_DepthMask == flag, m_DepthMask, m_Validate ? query(GL_DEPTH_WRITEMASK) : 0, "GL_DEPTH_WRITEMASK"))
+			return;
+		glDepthMask(flag);
+		m_DepthMask = flag;
+	}
+
+	void GLStateCache::depthFunc(GLenum func)
+	{
+		if (elide(m_DepthFunc == func, m_DepthFunc, m_Validate ? query(GL_DEPTH_FUNC) : 0, "GL_DEPTH_FUNC"))
+			return;
+		glDepthFunc(func);
+		m_DepthFunc = func;
+	}
+
+	void GLStateCache::blendFunc(GLenum sfactor, GLenum dfactor)
+	{
+		// glBlendFunc sets the alpha factors too, validating the RGB ones is enough to catch a stale shadow
+		bool same = m_BlendSrc == sfactor && m_BlendDst == dfactor;
+		if (elide(same, m_BlendSrc, m_Validate ? query(GL_BLEND_SRC_RGB) : 0, "GL_BLEND_SRC_RGB"))
+			return;
+		glBlendFunc(sfactor, dfactor);
+		m_BlendSrc = sfactor;
+		m_BlendDst = dfactor;
+	}
+
+	void GLStateCache::cullFace(GLenum mode)
+	{
+		if (elide(m_CullFace == mode, m_CullFace, m_Validate ? query(GL_CULL_FACE_MODE) : 0, "GL_CULL_FACE_MODE"))
+			return;
+		glCullFace(mode);
+		m_CullFace = mode;
+	}
+
+	void GLStateCache::deleteTextures(GLsizei count, const GLuint* textures)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+			{
+				for (int slot = 0; slot < TEXTURE_TARGET_COUNT; slot++)
+				{
+					if (m_Textures[unit][slot] == textures[i])
+						m_Textures[unit][slot] = 0;
+				}
+			}
+		}
+		glDeleteTextures(count, textures);
+	}
+
+	void GLStateCache::deleteBuffers(GLsizei count, const GLuint* buffers)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			for (int slot = 0; slot < BUFFER_TARGET_COUNT; slot++)
+			{
+				if (m_Buffers[slot] == buffers[i])
+					m_Buffers[slot] = 0;
+			}
+			// whether indexed bindings are reset depends on the GL version
+			for (int index = 0; index < GL_STATE_UNIFORM_BINDINGS; index++)
+			{
+				if (m_UniformBindings[index] == buffers[i])
+					m_UniformBindings[index] = GL_STATE_UNKNOWN;
+			}
+		}
+		glDeleteBuffers(count, buffers);
+	}
+
+	void GLStateCache::deleteVertexArrays(GLsizei count, const GLuint* arrays)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			if (m_VertexArray == arrays[i])
+				m_VertexArray = 0;
+		}
+		glDeleteVertexArrays(count, arrays);
+	}
+
+	void GLStateCache::deleteProgram(GLuint program)
+	{
+		// a current program lives on until it's replaced
+		if (m_Program == program)
+			m_Program = GL_STATE_UNKNOWN;
+		glDeleteProgram(program);
+	}
+
+	void GLStateCache::invalidate()
+	{
+		m_Program = GL_STATE_UNKNOWN;
+		m_VertexArray = GL_STATE_UNKNOWN;
+		for (GLuint& buffer : m_Buffers)
+			buffer = GL_STATE_UNKNOWN;
+		for (GLuint& buffer : m_UniformBindings)
+			buffer = GL_STATE_UNKNOWN;
+		m_ActiveTexture = GL_STATE_UNKNOWN;
+		for (auto& unit : m_Textures)
+		{
+			for (GLuint& texture : unit)
+				texture = GL_STATE_UNKNOWN;
+		}
+		for (GLuint& cap : m_Caps)
+			cap = GL_STATE_UNKNOWN;
+		m_DepthMask = GL_STATE_UNKNOWN;
+		m_DepthFunc = GL_STATE_UNKNOWN;
+		m_BlendSrc = GL_STATE_UNKNOWN;
+		m_BlendDst = GL_STATE_UNKNOWN;
+		m_CullFace = GL_STATE_UNKNOWN;
+	}
+
+	bool GLStateCache::validate()
+	{
+		size_t mismatches = 0;
+		auto check = [&mismatches](GLuint& shadow, GLuint actual, const char* what)
+		{
+			if (shadow == GL_STATE_UNKNOWN || shadow == actual)
+				return;
+			LOGL::error("bool GLStateCache::validate() -> %s is %u, the shadow says %u", what, actual, shadow);
+			shadow = GL_STATE_UNKNOWN;
+			mismatches++;
+		};
+
+		check(m_Program, query(GL_CURRENT_PROGRAM), "GL_CURRENT_PROGRAM");
+		check(m_VertexArray, query(GL_VERTEX_ARRAY_BINDING), "GL_VERTEX_ARRAY_BINDING");
+		for (int slot = 0; slot < BUFFER_TARGET_COUNT; slot++)
+			check(m_Buffers[slot], query(BUFFER_BINDINGS[slot]), "buffer binding");
+		for (GLuint index = 0; index < GL_STATE_UNIFORM_BINDINGS; index++)
+		{
+			GLint actual = 0;
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, index, &actual);
+			check(m_UniformBindings[index], (GLuint)actual, "GL_UNIFORM_BUFFER_BINDING");
+		}
+
+		GLuint active = query(GL_ACTIVE_TEXTURE);
+		for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			for (int slot = 0; slot < TEXTURE_TARGET_COUNT; slot++)
+				check(m_Textures[unit][slot], query(TEXTURE_BINDINGS[slot]), "texture binding");
+		}
+		glActiveTexture(active);
+		check(m_ActiveTexture, active, "GL_ACTIVE_TEXTURE");
+
+		for (int slot = 0; slot < CAP_COUNT; slot++)
+			check(m_Caps[slot], glIsEnabled(CAPS[slot]) ? 1 : 0, "capability");
+		check(m_DepthMask, query(GL_DEPTH_WRITEMASK), "GL_DEPTH_WRITEMASK");
+		check(m_DepthFunc, query(GL_DEPTH_FUNC), "GL_DEPTH_FUNC");
+		check(m_BlendSrc, query(GL_BLEND_SRC_RGB), "GL_BLEND_SRC_RGB");
+		check(m_BlendDst, query(GL_BLEND_DST_RGB), "GL_BLEND_DST_RGB");
+		check(m_CullFace, query(GL_CULL_FACE_MODE), "GL_CULL_FACE_MODE");
+
+		m_Frame.mismatches += mismatches;
+		return mismatches == 0;
+	}
+
+	void GLStateCache::setValidation(bool enabled)
+	{
+		m_Validate = enabled;
+	}
+
+	bool GLStateCache::getValidation() const
+	{
+		return m_Validate;
+	}
+
+	void GLStateCache::endFrame()
+	{
+		m_Stats = m_Frame;
+		m_Frame = GLStateStats();
+	}
+
+	const GLStateStats& GLStateCache::getStats() const
+	{
+		return m_Stats;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <cstddef>
+
+// texture units and uniform buffer bindings that are shadowed, higher ones always reach the driver
+#define GL_STATE_TEXTURE_UNITS 32
+#define GL_STATE_UNIFORM_BINDINGS 8
+
+namespace LOGL
+{
+    struct GLStateStats
+    {
+        // calls that reached the driver
+        size_t calls = 0;
+        // calls skipped because the shadow already held the value
+        size_t elided = 0;
+        // shadow values that differed from glGet*, only counted while validating
+        size_t mismatches = 0;
+    };
+
+    // shadows binds and fixed function switches of the context and drops calls that would not
+    // change them; every bind in LOGL goes through GLState, code that changes state behind its
+    // back (a library without restore, raw GL) has to call invalidate() afterwards
+    class GLStateCache
+    {
+    public:
+        GLStateCache();
+
+        void useProgram(GLuint program);
+        // asks the driver only after invalidate()
+        GLuint getProgram();
+        void bindVertexArray(GLuint vao);
+        // GL_ELEMENT_ARRAY_BUFFER is VAO state and always reaches the driver
+        void bindBuffer(GLenum target, GLuint buffer);
+        // also replaces the generic binding of target, as glBindBufferBase does
+        void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+        void activeTexture(GLenum unit);
+        // binds on the active unit
+        void bindTexture(GLenum target, GLuint texture);
+        // switches units only when texture isn't bound there already
+        void bindTextureUnit(GLuint unit, GLenum target, GLuint texture);
+
+        void enable(GLenum cap);
+        void disable(GLenum cap);
+        void depthMask(GLboolean flag);
+        void depthFunc(GLenum func);
+        void blendFunc(GLenum sfactor, GLenum dfactor);
+        void cullFace(GLenum mode);
+
+        // GL drops bindings of deleted objects, the names may come back from the next glGen*
+        void deleteTextures(GLsizei count, const GLuint* textures);
+        void deleteBuffers(GLsizei count, const GLuint* buffers);
+        void deleteVertexArrays(GLsizei count, const GLuint* arrays);
+        void deleteProgram(GLuint program);
+
+        // forgets every shadow value, the next call of each kind reaches the driver
+        void invalidate();
+        // compares every known shadow value with glGet*, logs and forgets the ones that differ
+        bool validate();
+        // validates before every elided call, on by default in debug builds
+        void setValidation(bool enabled);
+        bool getValidation() const;
+
+        // counters of the frame that just ended become getStats()
+        void endFrame();
+        const GLStateStats& getStats() const;
+    private:
+        int bufferSlot(GLenum target) const;
+        int textureSlot(GLenum target) const;
+        int capSlot(GLenum cap) const;
+        // true when the call can be skipped, counts it either way; while validating
+        // the shadow is compared with what the driver reports first
+        bool elide(bool same, GLuint shadow, GLuint actual, const char* what);
+        GLuint query(GLenum pname) const;
+        void setCap(GLenum cap, bool enabled);
+
+        static const int BUFFER_TARGET_COUNT = 7;
+        static const int TEXTURE_TARGET_COUNT = 5;
+        static const int CAP_COUNT = 6;
+
+        GLuint m_Program;
+        GLuint m_VertexArray;
+        GLuint m_Buffers[BUFFER_TARGET_COUNT];
+        GLuint m_UniformBindings[GL_STATE_UNIFORM_BINDINGS];
+        GLenum m_ActiveTexture;
+        GLuint m_Textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+        // 0, 1 or unknown
+        GLuint m_Caps[CAP_COUNT];
+        GLuint m_DepthMask;
+        GLuint m_DepthFunc;
+        GLuint m_BlendSrc;
+        GLuint m_BlendDst;
+        GLuint m_CullFace;
+
+        bool m_Validate;
+        GLStateStats m_Frame;
+        GLStateStats m_Stats;
+    };
+
+    extern GLStateCache GLState;
+}
@@ -0,0 +1,801 @@
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "logger.h"
+#include "stb_image.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+
+// one subtable per code longer than the first lookup at most, 288 literal/length and 32 distance symbols
+#define INFLATE_LITERAL_TABLE_SIZE ((1 << INFLATE_LITERAL_BITS) + 288 * (1 << (15 - INFLATE_LITERAL_BITS)))
+#define INFLATE_DISTANCE_TABLE_SIZE ((1 << INFLATE_DISTANCE_BITS) + 32 * (1 << (15 - INFLATE_DISTANCE_BITS)))
+#define INFLATE_CODE_LENGTH_BITS 7
+// match copies move 8 bytes at a time and may run past the end of the output
+#define IMAGE_DECODER_SLACK 16
+#define IMAGE_DECODER_BENCHMARK_RUNS 3
+
+namespace LOGL
+{
+	// a table entry is the code length in bits 0-3, the kind in 4-6, extra bits to read in 8-12
+	// (the size of the subtable for ENTRY_SUBTABLE) and the literal, base or subtable offset in 16-31
+	enum InflateEntry
+	{
+		ENTRY_LITERAL = 0,
+		ENTRY_BASE = 1,
+		ENTRY_END = 2,
+		ENTRY_SUBTABLE = 3,
+		ENTRY_INVALID = 4
+	};
+
+	enum InflateAlphabet
+	{
+		ALPHABET_LITERAL,
+		ALPHABET_DISTANCE,
+		ALPHABET_CODE_LENGTH
+	};
+
+	static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	static inline uint32_t makeEntry(uint32_t kind, uint32_t extra, uint32_t value)
+	{
+		return (value << 16) | (extra << 8) | (kind << 4);
+	}
+
+	static inline uint32_t entryKind(uint32_t entry) { return (entry >> 4) & 7; }
+	static inline uint32_t entryExtra(uint32_t entry) { return (entry >> 8) & 31; }
+	static inline uint32_t entryValue(uint32_t entry) { return entry >> 16; }
+
+	static uint32_t symbolEntry(InflateAlphabet alphabet, int symbol)
+	{
+		if (alphabet == ALPHABET_LITERAL)
+		{
+			if (symbol < 256)
+				return makeEntry(ENTRY_LITERAL, 0, symbol);
+			if (symbol == 256)
+				return makeEntry(ENTRY_END, 0, 0);
+			if (symbol < 286)
+				return makeEntry(ENTRY_BASE, lengthExtra[symbol - 257], lengthBase[symbol - 257]);
+			return makeEntry(ENTRY_INVALID, 0, 0);
+		}
+		if (alphabet == ALPHABET_DISTANCE)
+			return symbol < 30 ? makeEntry(ENTRY_BASE, distanceExtra[symbol], distanceBase[symbol]) : makeEntry(ENTRY_INVALID, 0, 0);
+		return makeEntry(ENTRY_LITERAL, 0, symbol);
+	}
+
+	// canonical Huffman codes from their lengths; codes up to primaryBits long are replicated over the
+	// first table, longer ones share a subtable per primaryBits prefix sized for the longest code under it
+	static bool buildTable(uint32_t* table, int primaryBits, const uint8_t* lengths, int count, InflateAlphabet alphabet)
+	{
+		int lengthCount[16] = {};
+		for (int i = 0; i < count; i++)
+			lengthCount[lengths[i]]++;
+		lengthCount[0] = 0;
+
+		// an incomplete code is allowed, a lone distance code is, but oversubscribed ones aren't prefix free
+		int left = 1;
+		for (int length = 1; length < 16; length++)
+		{
+			left = (left << 1) - lengthCount[length];
+			if (left < 0)
+				return false;
+		}
+
+		uint32_t nextCode[16];
+		uint32_t code = 0;
+		for (int length = 1; length < 16; length++)
+		{
+			code = (code + lengthCount[length - 1]) << 1;
+			nextCode[length] = code;
+		}
+
+		// the stream is read from the low bit, codes are packed from their high bit
+		uint16_t reversed[320];
+		for (int i = 0; i < count; i++)
+		{
+			int length = lengths[i];
+			if (!length)
+				continue;
+			uint32_t value = nextCode[length]++;
+			uint32_t result = 0;
+			for (int bit = 0; bit < length; bit++)
+				result |= ((value >> bit) & 1) << (length - 1 - bit);
+			reversed[i] = (uint16_t)result;
+		}
+
+		uint32_t primarySize = 1u << primaryBits;
+		uint8_t subtableBits[1 << INFLATE_LITERAL_BITS] = {};
+		for (int i = 0; i < count; i++)
+		{
+			if (lengths[i] > primaryBits)
+			{
+				uint32_t prefix = reversed[i] & (primarySize - 1);
+				subtableBits[prefix] = std::max(subtableBits[prefix], (uint8_t)(lengths[i] - primaryBits));
+			}
+		}
+
+		uint32_t invalid = makeEntry(ENTRY_INVALID, 0, 0);
+		std::fill(table, table + primarySize, invalid);
+		uint32_t offset = primarySize;
+		for (uint32_t prefix = 0; prefix < primarySize; prefix++)
+		{
+			if (!subtableBits[prefix])
+				continue;
+			table[prefix] = makeEntry(ENTRY_SUBTABLE, subtableBits[prefix], offset);
+			std::fill(table + offset, table + offset + (1u << subtableBits[prefix]), invalid);
+			offset += 1u << subtableBits[prefix];
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			int length = lengths[i];
+			if (!length)
+				continue;
+			uint32_t entry = symbolEntry(alphabet, i) | length;
+			if (length <= primaryBits)
+			{
+				for (uint32_t index = reversed[i]; index < primarySize; index += 1u << length)
+					table[index] = entry;
+			}
+			else
+			{
+				uint32_t pointer = table[reversed[i] & (primarySize - 1)];
+				uint32_t* subtable = table + entryValue(pointer);
+				for (uint32_t index = reversed[i] >> primaryBits; index < (1u << entryExtra(pointer)); index += 1u << (length - primaryBits))
+					subtable[index] = entry;
+			}
+		}
+		return true;
+	}
+
+	struct BitReader
+	{
+		const uint8_t* in;
+		const uint8_t* end;
+		uint64_t bits = 0;
+		unsigned int count = 0;
+		// zero bytes shifted in past the end, a few are normal for the last code
+		unsigned int padding = 0;
+
+		// at least 56 bits are buffered afterwards, enough for a length and distance with their extra bits
+		inline void refill()
+		{
+			if (end - in >= 8)
+			{
+				uint64_t word;
+				memcpy(&word, in, sizeof(word));
+				bits |= word << count;
+				in += (63 - count) >> 3;
+				count |= 56;
+			}
+			else
+			{
+				while (count <= 56)
+				{
+					if (in < end)
+						bits |= (uint64_t)*in++ << count;
+					else
+						padding++;
+					count += 8;
+				}
+			}
+		}
+
+		inline uint32_t peek(unsigned int bitCount) const
+		{
+			return (uint32_t)bits & ((1u << bitCount) - 1);
+		}
+
+		inline void consume(unsigned int bitCount)
+		{
+			bits >>= bitCount;
+			count -= bitCount;
+		}
+
+		inline uint32_t read(unsigned int bitCount)
+		{
+			uint32_t value = peek(bitCount);
+			consume(bitCount);
+			return value;
+		}
+	};
+
+	static inline uint32_t decodeSymbol(BitReader& reader, const uint32_t* table, int primaryBits)
+	{
+		uint32_t entry = table[reader.peek(primaryBits)];
+		if (entryKind(entry) == ENTRY_SUBTABLE)
+			entry = table[entryValue(entry) + ((uint32_t)(reader.bits >> primaryBits) & ((1u << entryExtra(entry)) - 1))];
+		reader.consume(entry & 15);
+		return entry;
+	}
+
+	static bool readDynamicTables(BitReader& reader, uint32_t* literals, uint32_t* distances)
+	{
+		reader.refill();
+		int literalCount = reader.read(5) + 257;
+		int distanceCount = reader.read(5) + 1;
+		int codeLengthCount = reader.read(4) + 4;
+		if (literalCount > 286)
+			return false;
+
+		uint8_t codeLengths[19] = {};
+		for (int i = 0; i < codeLengthCount; i++)
+		{
+			reader.refill();
+			codeLengths[codeLengthOrder[i]] = (uint8_t)reader.read(3);
+		}
+		uint32_t codeLengthTable[1 << INFLATE_CODE_LENGTH_BITS];
+		if (!buildTable(codeLengthTable, INFLATE_CODE_LENGTH_BITS, codeLengths, 19, ALPHABET_CODE_LENGTH))
+			return false;
+
+		uint8_t lengths[320] = {};
+		int total = literalCount + distanceCount;
+		for (int i = 0; i < total;)
+		{
+			reader.refill();
+			uint32_t entry = decodeSymbol(reader, codeLengthTable, INFLATE_CODE_LENGTH_BITS);
+			if (entryKind(entry) == ENTRY_INVALID)
+				return false;
+			uint32_t symbol = entryValue(entry);
+			if (symbol < 16)
+			{
+				lengths[i++] = (uint8_t)symbol;
+				continue;
+			}
+
+			uint8_t value = 0;
+			int repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+					return false;
+				value = lengths[i - 1];
+				repeat = 3 + reader.read(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + reader.read(3);
+			else
+				repeat = 11 + reader.read(7);
+			if (i + repeat > total)
+				return false;
+			memset(lengths + i, value, repeat);
+			i += repeat;
+		}
+
+		// a block without an end code can't be decoded
+		if (!lengths[256])
+			return false;
+		return buildTable(literals, INFLATE_LITERAL_BITS, lengths, literalCount, ALPHABET_LITERAL) &&
+			buildTable(distances, INFLATE_DISTANCE_BITS, lengths + literalCount, distanceCount, ALPHABET_DISTANCE);
+	}
+
+	static bool buildFixedTables(uint32_t* literals, uint32_t* distances)
+	{
+		uint8_t lengths[288];
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+		uint8_t distanceLengths[32];
+		memset(distanceLengths, 5, sizeof(distanceLengths));
+		return buildTable(literals, INFLATE_LITERAL_BITS, lengths, 288, ALPHABET_LITERAL) &&
+			buildTable(distances, INFLATE_DISTANCE_BITS, distanceLengths, 32, ALPHABET_DISTANCE);
+	}
+
+	// raw deflate into a buffer of the exact decoded size followed by IMAGE_DECODER_SLACK bytes;
+	// the adler32 trailer isn't checked, stb_image doesn't either
+	static bool inflate(const uint8_t* in, size_t size, uint8_t* out, size_t outSize)
+	{
+		std::vector<uint32_t> tables(INFLATE_LITERAL_TABLE_SIZE + INFLATE_DISTANCE_TABLE_SIZE);
+		uint32_t* literals = tables.data();
+		uint32_t* distances = literals + INFLATE_LITERAL_TABLE_SIZE;
+
+		BitReader reader;
+		reader.in = in;
+		reader.end = in + size;
+		uint8_t* const outStart = out;
+		uint8_t* const outEnd = out + outSize;
+
+		bool last = false;
+		while (!last)
+		{
+			reader.refill();
+			last = reader.read(1) != 0;
+			uint32_t type = reader.read(2);
+
+			if (type == 0)
+			{
+				reader.consume(reader.count & 7);
+				reader.refill();
+				uint32_t length = reader.read(16);
+				uint32_t inverse = reader.read(16);
+				if (length != (~inverse & 0xFFFF) || reader.padding || length > (size_t)(outEnd - out))
+					return false;
+				// the refill read ahead whole bytes, the stored bytes start where the header ended
+				reader.in -= reader.count >> 3;
+				reader.bits = 0;
+				reader.count = 0;
+				if (length > (size_t)(reader.end - reader.in))
+					return false;
+				memcpy(out, reader.in, length);
+				out += length;
+				reader.in += length;
+				continue;
+			}
+
+			if (type == 1)
+			{
+				if (!buildFixedTables(literals, distances))
+					return false;
+			}
+			else if (type != 2 || !readDynamicTables(reader, literals, distances))
+				return false;
+
+			for (;;)
+			{
+				reader.refill();
+				if (reader.padding > 8)
+					return false;
+				uint32_t entry = decodeSymbol(reader, literals, INFLATE_LITERAL_BITS);
+				uint32_t kind = entryKind(entry);
+				if (kind == ENTRY_LITERAL)
+				{
+					if (outEnd - out < 3)
+					{
+						if (out == outEnd)
+							return false;
+						*out++ = (uint8_t)entryValue(entry);
+						continue;
+					}
+					// a refill leaves enough bits for two more literals that don't need a subtable,
+					// a length and distance pair waits for the next refill
+					*out++ = (uint8_t)entryValue(entry);
+					entry = literals[reader.peek(INFLATE_LITERAL_BITS)];
+					if (entryKind(entry) != ENTRY_LITERAL)
+						continue;
+					reader.consume(entry & 15);
+					*out++ = (uint8_t)entryValue(entry);
+					entry = literals[reader.peek(INFLATE_LITERAL_BITS)];
+					if (entryKind(entry) != ENTRY_LITERAL)
+						continue;
+					reader.consume(entry & 15);
+					*out++ = (uint8_t)entryValue(entry);
+					continue;
+				}
+				if (kind == ENTRY_END)
+					break;
+				if (kind != ENTRY_BASE)
+					return false;
+
+				size_t length = entryValue(entry) + reader.read(entryExtra(entry));
+				entry = decodeSymbol(reader, distances, INFLATE_DISTANCE_BITS);
+				if (entryKind(entry) != ENTRY_BASE)
+					return false;
+				size_t distance = entryValue(entry) + reader.read(entryExtra(entry));
+				if (distance > (size_t)(out - outStart) || length > (size_t)(outEnd - out))
+					return false;
+
+				const uint8_t* from = out - distance;
+				uint8_t* stop = out + length;
+				if (distance >= 8)
+				{
+					// the last copy may write up to 7 bytes past stop, into the slack at worst
+					do
+					{
+						memcpy(out, from, 8);
+						out += 8;
+						from += 8;
+					} while (out < stop);
+				}
+				else if (distance == 1)
+					memset(out, *from, length);
+				else
+				{
+					for (size_t i = 0; i < length; i++)
+						out[i] = from[i];
+				}
+				out = stop;
+			}
+		}
+		return out == outEnd;
+	}
+
+	static inline __m128i loadPixel(const uint8_t* p)
+	{
+		int32_t value;
+		memcpy(&value, p, sizeof(value));
+		return _mm_cvtsi32_si128(value);
+	}
+
+	static inline void storePixel(uint8_t* p, __m128i pixel)
+	{
+		int32_t value = _mm_cvtsi128_si32(pixel);
+		memcpy(p, &value, sizeof(value));
+	}
+
+	static inline uint8_t paeth(int a, int b, int c)
+	{
+		int pa = abs(b - c);
+		int pb = abs(a - c);
+		int pc = abs(a + b - 2 * c);
+		if (pa <= pb && pa <= pc)
+			return (uint8_t)a;
+		return (uint8_t)(pb <= pc ? b : c);
+	}
+
+	// 3 and 4 byte pixels go through SSE one pixel at a time, the dependency on the left neighbour keeps it
+	// from going wider; pixels are loaded and stored as 4 bytes, the 4th of an RGB pixel is overwritten by
+	// the next one and the last pixel of a row is left to the scalar loop
+	static bool unfilterRow(uint8_t filter, uint8_t* row, const uint8_t* src, const uint8_t* prior, size_t stride, int bpp)
+	{
+		bool simd = bpp == 3 || bpp == 4;
+		size_t i = 0;
+		switch (filter)
+		{
+		case 0:
+			memcpy(row, src, stride);
+			return true;
+		case 1:
+			if (simd)
+			{
+				__m128i a = _mm_setzero_si128();
+				for (; i + 4 <= stride; i += bpp)
+				{
+					a = _mm_add_epi8(a, loadPixel(src + i));
+					storePixel(row + i, a);
+				}
+			}
+			for (; i < stride; i++)
+				row[i] = src[i] + (i >= (size_t)bpp ? row[i - bpp] : 0);
+			return true;
+		case 2:
+			for (; i + 16 <= stride; i += 16)
+				_mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(_mm_loadu_si128((const __m128i*)(src + i)), _mm_loadu_si128((const __m128i*)(prior + i))));
+			for (; i < stride; i++)
+				row[i] = src[i] + prior[i];
+			return true;
+		case 3:
+			if (simd)
+			{
+				// _mm_avg_epu8 rounds up, the filter rounds down
+				__m128i ones = _mm_set1_epi8(1);
+				__m128i a = _mm_setzero_si128();
+				for (; i + 4 <= stride; i += bpp)
+				{
+					__m128i b = loadPixel(prior + i);
+					__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), ones));
+					a = _mm_add_epi8(loadPixel(src + i), average);
+					storePixel(row + i, a);
+				}
+			}
+			for (; i < stride; i++)
+				row[i] = src[i] + (uint8_t)(((i >= (size_t)bpp ? row[i - bpp] : 0) + prior[i]) >> 1);
+			return true;
+		case 4:
+			if (simd)
+			{
+				__m128i zero = _mm_setzero_si128();
+				__m128i a = zero;
+				__m128i c = zero;
+				for (; i + 4 <= stride; i += bpp)
+				{
+					__m128i b = _mm_unpacklo_epi8(loadPixel(prior + i), zero);
+					__m128i p = _mm_sub_epi16(b, c);
+					__m128i q = _mm_sub_epi16(a, c);
+					__m128i pq = _mm_add_epi16(p, q);
+					__m128i pa = _mm_max_epi16(p, _mm_sub_epi16(zero, p));
+					__m128i pb = _mm_max_epi16(q, _mm_sub_epi16(zero, q));
+					__m128i pc = _mm_max_epi16(pq, _mm_sub_epi16(zero, pq));
+					__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+					// ties favour a over b over c
+					__m128i useA = _mm_cmpeq_epi16(smallest, pa);
+					__m128i useB = _mm_cmpeq_epi16(smallest, pb);
+					__m128i nearest = _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+					nearest = _mm_or_si128(_mm_and_si128(useA, a), _mm_andnot_si128(useA, nearest));
+					__m128i pixel = _mm_add_epi8(loadPixel(src + i), _mm_packus_epi16(nearest, nearest));
+					storePixel(row + i, pixel);
+					a = _mm_unpacklo_epi8(pixel, zero);
+					c = b;
+				}
+			}
+			for (; i < stride; i++)
+			{
+				if (i < (size_t)bpp)
+					row[i] = src[i] + prior[i];
+				else
+					row[i] = src[i] + paeth(row[i - bpp], prior[i], prior[i - bpp]);
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool isPNG(const uint8_t* bytes, size_t size)
+	{
+		static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		return size >= sizeof(signature) && memcmp(bytes, signature, sizeof(signature)) == 0;
+	}
+
+	static inline uint32_t readBigEndian(const uint8_t* p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+	// non interlaced 8 bit grey, grey alpha, RGB, RGBA and paletted PNGs; false leaves the file to stb_image,
+	// which also reports what's wrong with a broken one
+	static bool decodePNG(const uint8_t* bytes, size_t size, TextureImage& image)
+	{
+		if (!isPNG(bytes, size))
+			return false;
+
+		uint32_t width = 0, height = 0;
+		int colorType = -1;
+		uint8_t palette[256][4];
+		int paletteSize = 0;
+		bool paletteAlpha = false;
+		std::vector<std::pair<const uint8_t*, size_t>> chunks;
+		size_t compressedSize = 0;
+
+		for (size_t pos = 8; pos + 12 <= size;)
+		{
+			uint32_t length = readBigEndian(bytes + pos);
+			const uint8_t* type = bytes + pos + 4;
+			const uint8_t* data = bytes + pos + 8;
+			if (length > size - pos - 12)
+				return false;
+			pos += 12 + (size_t)length;
+
+			if (memcmp(type, "IHDR", 4) == 0)
+			{
+				if (length < 13)
+					return false;
+				width = readBigEndian(data);
+				height = readBigEndian(data + 4);
+				int bitDepth = data[8];
+				colorType = data[9];
+				int interlace = data[12];
+				if (bitDepth != 8 || interlace != 0 || (colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6))
+					return false;
+				if (!width || !height || width > (1u << 24) || height > (1u << 24) || (uint64_t)width * height > (1u << 28))
+					return false;
+			}
+			else if (memcmp(type, "PLTE", 4) == 0)
+			{
+				paletteSize = std::min((int)length / 3, 256);
+				for (int i = 0; i < paletteSize; i++)
+				{
+					memcpy(palette[i], data + i * 3, 3);
+					palette[i][3] = 255;
+				}
+			}
+			else if (memcmp(type, "tRNS", 4) == 0)
+			{
+				// a transparent colour key on grey or RGB images is stb_image's job
+				if (colorType != 3)
+					return false;
+				for (int i = 0; i < paletteSize && i < (int)length; i++)
+					palette[i][3] = data[i];
+				paletteAlpha = true;
+			}
+			else if (memcmp(type, "IDAT", 4) == 0)
+			{
+				chunks.push_back(std::make_pair(data, (size_t)length));
+				compressedSize += length;
+			}
+			else if (memcmp(type, "IEND", 4) == 0)
+				break;
+		}
+		if (colorType < 0 || chunks.empty() || (colorType == 3 && !paletteSize))
+			return false;
+
+		static const int bytesPerPixel[7] = { 1, 0, 3, 1, 2, 0, 4 };
+		int bpp = bytesPerPixel[colorType];
+		int channels = colorType == 3 ? (paletteAlpha ? 4 : 3) : bpp;
+		size_t stride = (size_t)width * bpp;
+
+		// the zlib stream is split over IDAT chunks, they're only joined when there are several
+		const uint8_t* stream = chunks[0].first;
+		std::vector<uint8_t> joined;
+		if (chunks.size() > 1)
+		{
+			joined.resize(compressedSize);
+			size_t offset = 0;
+			for (const std::pair<const uint8_t*, size_t>& chunk : chunks)
+			{
+				memcpy(joined.data() + offset, chunk.first, chunk.second);
+				offset += chunk.second;
+			}
+			stream = joined.data();
+		}
+		if (compressedSize < 2 || (stream[0] & 15) != 8 || (stream[1] & 32) || ((stream[0] << 8) | stream[1]) % 31)
+			return false;
+
+		size_t filteredSize = (stride + 1) * height;
+		std::unique_ptr<uint8_t[]> filtered(new uint8_t[filteredSize + IMAGE_DECODER_SLACK]);
+		if (!inflate(stream + 2, compressedSize - 2, filtered.get(), filteredSize))
+			return false;
+
+		size_t rowSize = (size_t)width * channels;
+		std::shared_ptr<unsigned char> pixels(new unsigned char[rowSize * height], std::default_delete<unsigned char[]>());
+		// row -1 is all zeros, paletted rows are reconstructed here before the lookup
+		std::vector<uint8_t> rows(stride * 3, 0);
+		uint8_t* zeroRow = rows.data();
+		uint8_t* indices[2] = { zeroRow + stride, zeroRow + 2 * stride };
+
+		const uint8_t* prior = zeroRow;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const uint8_t* src = filtered.get() + y * (stride + 1);
+			// bottom up, the row above in the file is the one after this in memory
+			uint8_t* dst = pixels.get() + (height - 1 - y) * rowSize;
+			uint8_t* row = colorType == 3 ? indices[y & 1] : dst;
+			if (!unfilterRow(src[0], row, src + 1, prior, stride, bpp))
+				return false;
+			prior = row;
+
+			if (colorType == 3)
+			{
+				for (uint32_t x = 0; x < width; x++)
+					memcpy(dst + x * channels, palette[row[x] < paletteSize ? row[x] : 0], channels);
+			}
+		}
+
+		static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		static const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+		image.internalFormat = internalFormats[channels - 1];
+		image.format = formats[channels - 1];
+		image.levels.assign(1, { (int)width, (int)height, 0, rowSize * height });
+		image.data = pixels;
+		return true;
+	}
+
+	static bool decodeWithStb(const uint8_t* bytes, size_t size, TextureImage& image)
+	{
+		static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		static const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load_thread(true);
+		unsigned char* pixels = stbi_load_from_memory(bytes, (int)size, &width, &height, &channels, 0);
+		if (!pixels)
+			return false;
+
+		image.internalFormat = internalFormats[channels - 1];
+		image.format = formats[channels - 1];
+		image.levels.assign(1, { width, height, 0, (size_t)width * height * channels });
+		image.data = std::shared_ptr<const unsigned char>(pixels, [](const unsigned char* data) { stbi_image_free((void*)data); });
+		return true;
+	}
+
+	bool decodeImage(const std::string& path, TextureImage& image)
+	{
+		// stb_image reads files through a 128 byte buffer, from the mapping it reads straight from memory
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+
+		const uint8_t* bytes = (const uint8_t*)file.data();
+		if (decodePNG(bytes, file.size(), image) || decodeWithStb(bytes, file.size(), image))
+			return true;
+
+		LOGL::error("bool decodeImage(const std::string& path, TextureImage& image) -> can't decode %s: %s", path.c_str(), stbi_failure_reason());
+		return false;
+	}
+
+	size_t decodeImages(const std::vector<std::string>& paths, std::vector<TextureImage>& images, unsigned int threadCount)
+	{
+		images.assign(paths.size(), TextureImage());
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		threadCount = (unsigned int)std::min((size_t)threadCount, paths.size());
+
+		std::atomic<size_t> next(0);
+		std::atomic<size_t> decoded(0);
+		auto work = [&]()
+		{
+			for (size_t i = next++; i < paths.size(); i = next++)
+			{
+				if (decodeImage(paths[i], images[i]))
+					decoded++;
+				else
+					images[i] = TextureImage();
+			}
+		};
+
+		// the calling thread decodes too
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++)
+			threads.push_back(std::thread(work));
+		work();
+		for (std::thread& thread : threads)
+			thread.join();
+		return decoded;
+	}
+
+	struct DecodeTimes
+	{
+		int files = 0;
+		double megabytes = 0.0;
+		double stbSeconds = 0.0;
+		double decoderSeconds = 0.0;
+		int mismatches = 0;
+	};
+
+	// best of IMAGE_DECODER_BENCHMARK_RUNS, the file stays mapped so only decoding is timed
+	template<typename Decode>
+	static double timeDecode(Decode decode, TextureImage& image)
+	{
+		double best = 1e30;
+		for (int run = 0; run < IMAGE_DECODER_BENCHMARK_RUNS; run++)
+		{
+			image = TextureImage();
+			auto start = std::chrono::steady_clock::now();
+			if (!decode(image))
+				return -1.0;
+			best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool benchmarkDecode(const std::vector<std::string>& paths)
+	{
+		std::map<std::string, DecodeTimes> formats;
+		double totalMegabytes = 0.0;
+		for (const std::string& path : paths)
+		{
+			MappedFile file;
+			if (!file.open(path))
+				return false;
+			const uint8_t* bytes = (const uint8_t*)file.data();
+			size_t size = file.size();
+
+			TextureImage reference, image;
+			double stbSeconds = timeDecode([&](TextureImage& out) { return decodeWithStb(bytes, size, out); }, reference);
+			double decoderSeconds = timeDecode([&](TextureImage& out) { return decodePNG(bytes, size, out) || decodeWithStb(bytes, size, out); }, image);
+			if (stbSeconds < 0.0 || decoderSeconds < 0.0)
+			{
+				LOGL::error("bool benchmarkDecode(const std::vector<std::string>& paths) -> can't decode %s: %s", path.c_str(), stbi_failure_reason());
+				return false;
+			}
+
+			size_t dot = path.find_last_of('.');
+			std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+			for (char& c : extension)
+				c = (char)tolower(c);
+			DecodeTimes& times = formats[extension];
+			const TextureLevel& level = reference.levels[0];
+			times.files++;
+			times.megabytes += level.size / (1024.0 * 1024.0);
+			times.stbSeconds += stbSeconds;
+			times.decoderSeconds += decoderSeconds;
+			if (image.levels[0].size != level.size || memcmp(image.data.get(), reference.data.get(), level.size) != 0)
+				times.mismatches++;
+			totalMegabytes += level.size / (1024.0 * 1024.0);
+		}
+
+		for (const std::pair<const std::string, DecodeTimes>& format : formats)
+		{
+			const DecodeTimes& times = format.second;
+			LOGL::log("bool benchmarkDecode(const std::vector<std::string>& paths) -> %-4s %4d files %8.1f MB  stb_image %7.1f MB/s  decodeImage %7.1f MB/s  %d differ",
+				format.first.c_str(), times.files, times.megabytes, times.megabytes / times.stbSeconds, times.megabytes / times.decoderSeconds, times.mismatches);
+		}
+
+		std::vector<TextureImage> images;
+		unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+		auto start = std::chrono::steady_clock::now();
+		size_t decoded = decodeImages(paths, images, threadCount);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		LOGL::log("bool benchmarkDecode(const std::vector<std::string>& paths) -> decodeImages on %u threads: %d/%d files, %.1f MB/s",
+			threadCount, (int)decoded, (int)paths.size(), totalMegabytes / seconds);
+		return decoded == paths.size();
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "TextureFile.h"
+#include <string>
+#include <vector>
+
+// bits resolved by the first lookup of a literal/length or distance code, longer codes go through a subtable
+#define INFLATE_LITERAL_BITS 10
+#define INFLATE_DISTANCE_BITS 8
+
+namespace LOGL
+{
+	// 8 bit PNGs go through a table driven inflate and SSE filter reconstruction, everything else
+	// (JPEG, BMP, TGA, 16 bit or interlaced PNGs) through stb_image; rows bottom up like loadTextureImage()
+	bool decodeImage(const std::string& path, TextureImage& image);
+
+	// decodes independent files on threadCount threads, 0 is one per core;
+	// images[i] has no levels where paths[i] failed, returns how many were decoded
+	size_t decodeImages(const std::vector<std::string>& paths, std::vector<TextureImage>& images, unsigned int threadCount = 0);
+
+	// decodes every file with stb_image and with decodeImage(), prints MB/s of pixels per format
+	// and of decodeImages() over all of them
+	bool benchmarkDecode(const std::vector<std::string>& paths);
+}
@@ -0,0 +1,165 @@
+#include "InstanceBuffer.h"
+#include "GLState.h"
+#include <cstddef>
+#include <cmath>
+#include <xmmintrin.h>
+
+// relative tolerance for treating the upper 3x3 as rotation * uniform scale
+#define NORMAL_MATRIX_EPSILON 1e-5f
+
+namespace LOGL
+{
+	// a.yzx * b.zxy - a.zxy * b.yzx, w stays a.w * b.w - a.w * b.w
+	static inline __m128 cross(__m128 a, __m128 b)
+	{
+		__m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	glm::mat3 normalMatrix(const glm::mat4& model)
+	{
+		glm::vec3 x(model[0]);
+		glm::vec3 y(model[1]);
+		glm::vec3 z(model[2]);
+
+		// rotation * s: the inverse transpose is the same matrix divided by s^2
+		float s2 = glm::dot(x, x);
+		float eps = NORMAL_MATRIX_EPSILON * s2;
+		if (std::fabs(glm::dot(y, y) - s2) <= eps && std::fabs(glm::dot(z, z) - s2) <= eps &&
+			std::fabs(glm::dot(x, y)) <= eps && std::fabs(glm::dot(x, z)) <= eps && std::fabs(glm::dot(y, z)) <= eps && s2 > 0.0f)
+			return glm::mat3(x / s2, y / s2, z / s2);
+
+		// columns of the inverse transpose are the cross products of the other two columns over the determinant
+		__m128 c0 = _mm_loadu_ps(&model[0][0]);
+		__m128 c1 = _mm_loadu_ps(&model[1][0]);
+		__m128 c2 = _mm_loadu_ps(&model[2][0]);
+		__m128 r0 = cross(c1, c2);
+		__m128 r1 = cross(c2, c0);
+		__m128 r2 = cross(c0, c1);
+
+		__m128 d = _mm_mul_ps(c0, r0);
+		float det = _mm_cvtss_f32(d) + _mm_cvtss_f32(_mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))) + _mm_cvtss_f32(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 2, 2)));
+		__m128 invDet = _mm_set1_ps(det != 0.0f ? 1.0f / det : 0.0f);
+
+		float result[12];
+		_mm_storeu_ps(result, _mm_mul_ps(r0, invDet));
+		_mm_storeu_ps(result + 4, _mm_mul_ps(r1, invDet));
+		_mm_storeu_ps(result + 8, _mm_mul_ps(r2, invDet));
+		return glm::mat3(result[0], result[1], result[2], result[4], result[5], result[6], result[8], result[9], result[10]);
+	}
+
+	InstanceData makeInstance(const glm::mat4& model, GLint material)
+	{
+		InstanceData instance;
+		instance.model = model;
+		instance.normal = normalMatrix(model);
+		instance.material = material;
+		return instance;
+	}
+
+	void setInstanceAttribs(const glm::mat4& model, GLint material)
+	{
+		setInstanceModel(model);
+		setInstanceMaterial(material);
+	}
+
+	void setInstanceAttribs(const InstanceData& instance)
+	{
+		for (int i = 0; i < 4; i++)
+			glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + i, &instance.model[i][0]);
+		for (int i = 0; i < 3; i++)
+			glVertexAttrib3fv(INSTANCE_NORMAL_LOCATION + i, &instance.normal[i][0]);
+		setInstanceMaterial(instance.material);
+	}
+
+	void setInstanceModel(const glm::mat4& model)
+	{
+		glm::mat3 normal = normalMatrix(model);
+		for (int i = 0; i < 4; i++)
+			glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + i, &model[i][0]);
+		for (int i = 0; i < 3; i++)
+			glVertexAttrib3fv(INSTANCE_NORMAL_LOCATION + i, &normal[i][0]);
+	}
+
+	void setInstanceMaterial(GLint material)
+	{
+		glVertexAttribI4i(INSTANCE_MATERIAL_LOCATION, material, 0, 0, 0);
+	}
+
+	InstanceBuffer::InstanceBuffer()
+	{
+	}
+
+	void InstanceBuffer::init(size_t capacity)
+	{
+		m_Capacity = capacity ? capacity : 1;
+		glGenBuffers(1, &m_Buffer);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+		glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void InstanceBuffer::attach(GLuint vao)
+	{
+		GLState.bindVertexArray(vao);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+		for (int i = 0; i < 4; i++)
+		{
+			glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+			glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+			glVertexAttribDivisor(INSTANCE_NORMAL_LOCATION + i, 1);
+			glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + i);
+		}
+		glVertexAttribIPointer(INSTANCE_MATERIAL_LOCATION, 1, GL_INT, sizeof(InstanceData), (void*)offsetof(InstanceData, material));
+		glVertexAttribDivisor(INSTANCE_MATERIAL_LOCATION, 1);
+		glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+		GLState.bindVertexArray(0);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void InstanceBuffer::upload(const InstanceData* instances, size_t count)
+	{
+		GLState.bindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+		while (m_Capacity < count)
+			m_Capacity *= 2;
+		// orphan, the previous frame may still be reading the old storage
+		glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+		m_Count = count;
+	}
+
+	void InstanceBuffer::draw(GLuint vao, GLsizei vertexCount, GLenum mode)
+	{
+		if (!m_Count)
+			return;
+
+		GLState.bindVertexArray(vao);
+		glDrawArraysInstanced(mode, 0, vertexCount, (GLsizei)m_Count);
+	}
+
+	void InstanceBuffer::drawIndexed(GLuint vao, GLsizei indexCount, GLenum indexType, GLenum mode)
+	{
+		if (!m_Count)
+			return;
+
+		GLState.bindVertexArray(vao);
+		glDrawElementsInstanced(mode, indexCount, indexType, 0, (GLsizei)m_Count);
+	}
+
+	GLuint InstanceBuffer::getBuffer() const
+	{
+		return m_Buffer;
+	}
+
+	size_t InstanceBuffer::getCount() const
+	{
+		return m_Count;
+	}
+}
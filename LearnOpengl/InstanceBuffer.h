@@ -0,0 +1,59 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+// per instance vertex attributes read by basic_lightningvs,
+// matrices take one location per column
+#define INSTANCE_MODEL_LOCATION 3
+#define INSTANCE_NORMAL_LOCATION 7
+#define INSTANCE_MATERIAL_LOCATION 10
+
+namespace LOGL
+{
+    // one element of the instance buffer
+    struct InstanceData
+    {
+        glm::mat4 model;
+        // transpose(inverse(mat3(model))), see normalMatrix()
+        glm::mat3 normal;
+        GLint material;
+    };
+    static_assert(sizeof(InstanceData) == 104, "InstanceData must stay tightly packed");
+
+    // inverse transpose of the upper 3x3, rotations with uniform scale skip the inverse
+    glm::mat3 normalMatrix(const glm::mat4& model);
+
+    InstanceData makeInstance(const glm::mat4& model, GLint material = 0);
+
+    // sets the instance attributes as constant values for draws without an instance buffer
+    void setInstanceAttribs(const glm::mat4& model, GLint material = 0);
+    // same with the normal matrix of instance instead of a new one
+    void setInstanceAttribs(const InstanceData& instance);
+    // the model and normal matrix half of setInstanceAttribs()
+    void setInstanceModel(const glm::mat4& model);
+    void setInstanceMaterial(GLint material);
+
+    // streams InstanceData into a buffer that VAOs read with divisor 1
+    class InstanceBuffer
+    {
+    public:
+        InstanceBuffer();
+        void init(size_t capacity = 1024);
+        // adds the instance attributes to vao, the VAO is then only usable for instanced draws
+        void attach(GLuint vao);
+        // orphans the buffer, grows it when count exceeds the capacity
+        void upload(const InstanceData* instances, size_t count);
+        // one glDrawArraysInstanced over the uploaded instances
+        void draw(GLuint vao, GLsizei vertexCount, GLenum mode = GL_TRIANGLES);
+        // one glDrawElementsInstanced, vao must have its element buffer bound
+        void drawIndexed(GLuint vao, GLsizei indexCount, GLenum indexType, GLenum mode = GL_TRIANGLES);
+
+        GLuint getBuffer() const;
+        size_t getCount() const;
+    private:
+        GLuint m_Buffer = 0;
+        size_t m_Capacity = 0;
+        size_t m_Count = 0;
+    };
+}
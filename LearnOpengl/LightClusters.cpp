@@ -0,0 +1,224 @@
+#include "LightClusters.h"
+#include "BasicLightning.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <xmmintrin.h>
+
+namespace LOGL
+{
+	LightClusters::LightClusters()
+	{
+	}
+
+	void LightClusters::init()
+	{
+		m_MinX.assign(CLUSTER_COUNT + 3, 0.0f);
+		m_MinY.assign(CLUSTER_COUNT + 3, 0.0f);
+		m_MinZ.assign(CLUSTER_COUNT + 3, 0.0f);
+		m_MaxX.assign(CLUSTER_COUNT + 3, 0.0f);
+		m_MaxY.assign(CLUSTER_COUNT + 3, 0.0f);
+		m_MaxZ.assign(CLUSTER_COUNT + 3, 0.0f);
+		m_Grid.assign(CLUSTER_COUNT * 2, 0);
+
+		glGenBuffers(1, &m_GridBuffer);
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, m_GridBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, m_Grid.size() * sizeof(GLuint), m_Grid.data(), GL_STREAM_DRAW);
+
+		m_IndexCapacity = CLUSTER_COUNT;
+		glGenBuffers(1, &m_IndexBuffer);
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, m_IndexBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, m_IndexCapacity * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		glGenTextures(1, &m_GridTexture);
+		GLState.bindTexture(GL_TEXTURE_BUFFER, m_GridTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_GridBuffer);
+		glGenTextures(1, &m_IndexTexture);
+		GLState.bindTexture(GL_TEXTURE_BUFFER, m_IndexTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_IndexBuffer);
+		GLState.bindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+
+	void LightClusters::buildClusterBounds(const glm::mat4& proj)
+	{
+		m_Proj = proj;
+		// glm::perspective, right handed, depth -1..1
+		m_Near = proj[3][2] / (proj[2][2] - 1.0f);
+		m_Far = proj[3][2] / (proj[2][2] + 1.0f);
+		m_TanX = 1.0f / proj[0][0];
+		m_TanY = 1.0f / proj[1][1];
+
+		for (int z = 0; z < CLUSTER_GRID_Z; z++)
+		{
+			float dn = m_Near * std::pow(m_Far / m_Near, (float)z / CLUSTER_GRID_Z);
+			float df = m_Near * std::pow(m_Far / m_Near, (float)(z + 1) / CLUSTER_GRID_Z);
+			for (int y = 0; y < CLUSTER_GRID_Y; y++)
+			{
+				float y0 = (2.0f * y / CLUSTER_GRID_Y - 1.0f) * m_TanY;
+				float y1 = (2.0f * (y + 1) / CLUSTER_GRID_Y - 1.0f) * m_TanY;
+				for (int x = 0; x < CLUSTER_GRID_X; x++)
+				{
+					float x0 = (2.0f * x / CLUSTER_GRID_X - 1.0f) * m_TanX;
+					float x1 = (2.0f * (x + 1) / CLUSTER_GRID_X - 1.0f) * m_TanX;
+
+					int i = x + y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+					m_MinX[i] = std::min(x0 * dn, x0 * df);
+					m_MaxX[i] = std::max(x1 * dn, x1 * df);
+					m_MinY[i] = std::min(y0 * dn, y0 * df);
+					m_MaxY[i] = std::max(y1 * dn, y1 * df);
+					m_MinZ[i] = -df;
+					m_MaxZ[i] = -dn;
+				}
+			}
+		}
+	}
+
+	void LightClusters::testRow(int base, int x0, int x1, const glm::vec3& center, float radius, GLuint light)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 cx = _mm_set1_ps(center.x);
+		const __m128 cy = _mm_set1_ps(center.y);
+		const __m128 cz = _mm_set1_ps(center.z);
+		const __m128 r2 = _mm_set1_ps(radius * radius);
+
+		// sphere vs AABB for 4 neighbouring clusters at once
+		for (int x = x0; x <= x1; x += 4)
+		{
+			int i = base + x;
+			__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinX[i]), cx), zero), _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(&m_MaxX[i])), zero));
+			__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinY[i]), cy), zero), _mm_max_ps(_mm_sub_ps(cy, _mm_loadu_ps(&m_MaxY[i])), zero));
+			__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinZ[i]), cz), zero), _mm_max_ps(_mm_sub_ps(cz, _mm_loadu_ps(&m_MaxZ[i])), zero));
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+
+			for (int k = 0; k < 4 && x + k <= x1; k++)
+			{
+				if (mask & (1 << k))
+				{
+					m_HitCluster.push_back(i + k);
+					m_HitLight.push_back(light);
+				}
+			}
+		}
+	}
+
+	float getLightRadius(const LightSourceStd140& ls)
+	{
+		float brightest = std::max({ ls.ambient.x, ls.ambient.y, ls.ambient.z, ls.diffuse.x, ls.diffuse.y, ls.diffuse.z, ls.specular.x, ls.specular.y, ls.specular.z });
+		float c = ls.constant - 256.0f * brightest;
+		if (c >= 0.0f)
+			return 0.0f;
+		if (ls.quadratic <= 0.0f)
+			return ls.linear > 0.0f ? -c / ls.linear : 1e30f;
+		return (-ls.linear + std::sqrt(ls.linear * ls.linear - 4.0f * ls.quadratic * c)) / (2.0f * ls.quadratic);
+	}
+
+	static int sliceIndex(float depth, float zNear, float zFar)
+	{
+		if (depth <= zNear)
+			return 0;
+		int slice = (int)(std::log(depth / zNear) / std::log(zFar / zNear) * CLUSTER_GRID_Z);
+		return std::min(slice, CLUSTER_GRID_Z - 1);
+	}
+
+	static int tileIndex(float ndc, int tiles)
+	{
+		int tile = (int)std::floor((ndc * 0.5f + 0.5f) * tiles);
+		return std::max(0, std::min(tile, tiles - 1));
+	}
+
+	void LightClusters::assign(const LightSourceStd140* lights, int count, const glm::mat4& view, const glm::mat4& proj)
+	{
+		if (proj != m_Proj)
+			buildClusterBounds(proj);
+
+		m_HitCluster.clear();
+		m_HitLight.clear();
+
+		for (int l = 0; l < count; l++)
+		{
+			const LightSourceStd140& ls = lights[l];
+			// directional lights are shaded outside of the clusters
+			if (ls.isDirLight)
+				continue;
+
+			float radius = getLightRadius(ls);
+			glm::vec3 c = glm::vec3(view * glm::vec4(ls.position, 1.0f));
+			float dmin = -c.z - radius;
+			float dmax = -c.z + radius;
+			if (radius <= 0.0f || dmax < m_Near || dmin > m_Far)
+				continue;
+
+			int z0 = sliceIndex(dmin, m_Near, m_Far);
+			int z1 = sliceIndex(dmax, m_Near, m_Far);
+
+			// screen space bounds of the sphere's view space box, extremes are at its corners
+			float d0 = std::max(dmin, m_Near);
+			float d1 = dmax;
+			float nx[4] = { (c.x - radius) / (d0 * m_TanX), (c.x - radius) / (d1 * m_TanX), (c.x + radius) / (d0 * m_TanX), (c.x + radius) / (d1 * m_TanX) };
+			float ny[4] = { (c.y - radius) / (d0 * m_TanY), (c.y - radius) / (d1 * m_TanY), (c.y + radius) / (d0 * m_TanY), (c.y + radius) / (d1 * m_TanY) };
+			float nxMin = std::min({ nx[0], nx[1], nx[2], nx[3] });
+			float nxMax = std::max({ nx[0], nx[1], nx[2], nx[3] });
+			float nyMin = std::min({ ny[0], ny[1], ny[2], ny[3] });
+			float nyMax = std::max({ ny[0], ny[1], ny[2], ny[3] });
+			if (nxMax < -1.0f || nxMin > 1.0f || nyMax < -1.0f || nyMin > 1.0f)
+				continue;
+
+			int x0 = tileIndex(nxMin, CLUSTER_GRID_X);
+			int x1 = tileIndex(nxMax, CLUSTER_GRID_X);
+			int y0 = tileIndex(nyMin, CLUSTER_GRID_Y);
+			int y1 = tileIndex(nyMax, CLUSTER_GRID_Y);
+
+			for (int z = z0; z <= z1; z++)
+				for (int y = y0; y <= y1; y++)
+					testRow(y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y, x0, x1, c, radius, l);
+		}
+
+		// counting sort of the hits by cluster
+		std::fill(m_Grid.begin(), m_Grid.end(), 0);
+		for (GLuint cluster : m_HitCluster)
+			m_Grid[cluster * 2 + 1]++;
+		GLuint offset = 0;
+		for (int i = 0; i < CLUSTER_COUNT; i++)
+		{
+			m_Grid[i * 2] = offset;
+			offset += m_Grid[i * 2 + 1];
+			m_Grid[i * 2 + 1] = 0;
+		}
+		m_Indices.resize(m_HitLight.size());
+		for (size_t h = 0; h < m_HitCluster.size(); h++)
+		{
+			GLuint cluster = m_HitCluster[h];
+			m_Indices[m_Grid[cluster * 2] + m_Grid[cluster * 2 + 1]++] = m_HitLight[h];
+		}
+
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, m_GridBuffer);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, m_Grid.size() * sizeof(GLuint), m_Grid.data());
+		GLState.bindBuffer(GL_TEXTURE_BUFFER, m_IndexBuffer);
+		if (m_Indices.size() > m_IndexCapacity)
+		{
+			m_IndexCapacity = m_Indices.size() * 2;
+			glBufferData(GL_TEXTURE_BUFFER, m_IndexCapacity * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+		}
+		if (!m_Indices.empty())
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, m_Indices.size() * sizeof(GLuint), m_Indices.data());
+	}
+
+	void LightClusters::bind(GLenum gridUnit, GLenum indexUnit)
+	{
+		GLState.bindTextureUnit(gridUnit - GL_TEXTURE0, GL_TEXTURE_BUFFER, m_GridTexture);
+		GLState.bindTextureUnit(indexUnit - GL_TEXTURE0, GL_TEXTURE_BUFFER, m_IndexTexture);
+	}
+
+	glm::vec2 LightClusters::getDepthParams() const
+	{
+		float scale = CLUSTER_GRID_Z / std::log(m_Far / m_Near);
+		return glm::vec2(scale, -std::log(m_Near) * scale);
+	}
+
+	int LightClusters::getIndexCount() const
+	{
+		return (int)m_Indices.size();
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include <vector>
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+
+namespace LOGL
+{
+    struct LightSourceStd140;
+
+    // distance where attenuation drops the brightest channel below 1/256
+    float getLightRadius(const LightSourceStd140& ls);
+
+    // froxel grid over the view frustum, point and spot lights are binned into it on the CPU every frame
+    // and uploaded as two texture buffers: (offset, count) per cluster and a flat light index list
+    class LightClusters
+    {
+    public:
+        LightClusters();
+        void init();
+        void assign(const LightSourceStd140* lights, int count, const glm::mat4& view, const glm::mat4& proj);
+        void bind(GLenum gridUnit, GLenum indexUnit);
+
+        // z slice = log(depth) * x + y
+        glm::vec2 getDepthParams() const;
+        int getIndexCount() const;
+    private:
+        void buildClusterBounds(const glm::mat4& proj);
+        void testRow(int base, int x0, int x1, const glm::vec3& center, float radius, GLuint light);
+
+        glm::mat4 m_Proj = glm::mat4(0.0f);
+        float m_Near = 0.0f;
+        float m_Far = 0.0f;
+        float m_TanX = 0.0f;
+        float m_TanY = 0.0f;
+
+        // view space cluster bounds, SoA and padded so rows can be read 4 at a time
+        std::vector<float> m_MinX, m_MinY, m_MinZ;
+        std::vector<float> m_MaxX, m_MaxY, m_MaxZ;
+
+        std::vector<GLuint> m_HitCluster;
+        std::vector<GLuint> m_HitLight;
+        std::vector<GLuint> m_Grid;
+        std::vector<GLuint> m_Indices;
+
+        GLuint m_GridBuffer = 0;
+        GLuint m_GridTexture = 0;
+        GLuint m_IndexBuffer = 0;
+        GLuint m_IndexTexture = 0;
+        size_t m_IndexCapacity = 0;
+    };
+}
@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+#include "logger.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace LOGL
+{
+	MappedFile::MappedFile()
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			LOGL::error("bool MappedFile::open(const std::string& path) -> can't open %s", path.c_str());
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			LOGL::error("bool MappedFile::open(const std::string& path) -> %s is empty", path.c_str());
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (!data)
+		{
+			LOGL::error("bool MappedFile::open(const std::string& path) -> can't map %s", path.c_str());
+			if (mapping)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_File = file;
+		m_Mapping = mapping;
+		m_Data = data;
+		m_Size = (size_t)size.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			LOGL::error("bool MappedFile::open(const std::string& path) -> can't open %s", path.c_str());
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			LOGL::error("bool MappedFile::open(const std::string& path) -> %s is empty", path.c_str());
+			::close(fd);
+			return false;
+		}
+
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// the mapping keeps its own reference to the file
+		::close(fd);
+		if (data == MAP_FAILED)
+		{
+			LOGL::error("bool MappedFile::open(const std::string& path) -> can't map %s", path.c_str());
+			return false;
+		}
+		// the whole file is uploaded right away, start reading it in
+		madvise(data, (size_t)info.st_size, MADV_WILLNEED);
+
+		m_Data = data;
+		m_Size = (size_t)info.st_size;
+#endif
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (!m_Data)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_Data);
+		CloseHandle(m_Mapping);
+		CloseHandle(m_File);
+		m_Mapping = nullptr;
+		m_File = nullptr;
+#else
+		munmap((void*)m_Data, m_Size);
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	const void* MappedFile::data() const
+	{
+		return m_Data;
+	}
+
+	size_t MappedFile::size() const
+	{
+		return m_Size;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace LOGL
+{
+	// read only mapping of a whole file, the pages are faulted in by the OS as they are read
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+		void close();
+
+		const void* data() const;
+		size_t size() const;
+	private:
+		const void* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef _WIN32
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#endif
+	};
+}
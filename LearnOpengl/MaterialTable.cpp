@@ -0,0 +1,332 @@
+#include "MaterialTable.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "BlockCompression.h"
+#include "logger.h"
+#include <algorithm>
+
+namespace LOGL
+{
+	static GLenum pixelFormat(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:
+			return GL_RED;
+		case GL_RG8:
+			return GL_RG;
+		case GL_RGB8:
+			return GL_RGB;
+		default:
+			return GL_RGBA;
+		}
+	}
+
+	static bool isCompressed(GLenum internalFormat)
+	{
+		return internalFormat != GL_R8 && internalFormat != GL_RG8 && internalFormat != GL_RGB8 && internalFormat != GL_RGBA8;
+	}
+
+	static size_t levelSize(GLenum internalFormat, int width, int height)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:
+			return (size_t)width * height;
+		case GL_RG8:
+			return (size_t)width * height * 2;
+		case GL_RGB8:
+			return (size_t)width * height * 3;
+		case GL_RGBA8:
+			return (size_t)width * height * 4;
+		default:
+			return getCompressedSize(internalFormat, width, height);
+		}
+	}
+
+	MaterialTable::MaterialTable()
+	{
+	}
+
+	void MaterialTable::init(TextureCache& cache, TextureStreamer& streamer)
+	{
+		m_Cache = &cache;
+		m_Streamer = &streamer;
+
+		glGenBuffers(1, &m_UBO);
+		GLState.bindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+		glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(MaterialStd140), NULL, GL_DYNAMIC_DRAW);
+		GLState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		if (!GLExt.ARB_copy_image)
+			glGenBuffers(1, &m_CopyBuffer);
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_MaxLayers);
+	}
+
+	GLint MaterialTable::add(const MaterialDesc& desc)
+	{
+		if (m_Materials.size() == MAX_MATERIALS)
+		{
+			LOGL::error("GLint MaterialTable::add(const MaterialDesc& desc) -> more than %d materials", MAX_MATERIALS);
+			return 0;
+		}
+
+		GLint material = (GLint)m_Materials.size();
+		MaterialStd140 data = { -1, 0, -1, 0, desc.shininess, {} };
+		m_Materials.push_back(data);
+		m_Dirty = true;
+
+		request(desc.diffuse, desc.params, { material, false });
+		request(desc.specular, desc.params, { material, true });
+		return material;
+	}
+
+	void MaterialTable::request(const std::string& path, const TextureParams& params, LayerUser user)
+	{
+		std::string key = m_Cache->makeKey(path, params);
+		auto placed = m_Layers.find(key);
+		if (placed != m_Layers.end())
+		{
+			assign(user, placed->second.first, placed->second.second);
+			return;
+		}
+		for (PendingLayer& pending : m_Pending)
+		{
+			if (pending.key == key)
+			{
+				pending.users.push_back(user);
+				return;
+			}
+		}
+		m_Pending.push_back({ m_Cache->get(path, params), key, { user } });
+	}
+
+	void MaterialTable::assign(const LayerUser& user, GLint array, GLint layer)
+	{
+		MaterialStd140& material = m_Materials[user.material];
+		if (user.specular)
+		{
+			material.specularArray = array;
+			material.specularLayer = layer;
+		}
+		else
+		{
+			material.diffuseArray = array;
+			material.diffuseLayer = layer;
+		}
+		m_Dirty = true;
+	}
+
+	void MaterialTable::update()
+	{
+		// placed textures are released, the cache may evict them as the layer holds a copy
+		m_Pending.erase(std::remove_if(m_Pending.begin(), m_Pending.end(), [this](PendingLayer& pending) { return place(pending); }), m_Pending.end());
+
+		if (m_Dirty)
+		{
+			GLState.bindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, m_Materials.size() * sizeof(MaterialStd140), m_Materials.data());
+			m_Dirty = false;
+		}
+	}
+
+	bool MaterialTable::place(PendingLayer& pending)
+	{
+		GLuint texture = pending.texture->ID;
+		if (m_Streamer->isPending(texture))
+			return false;
+		if (!m_Streamer->isReady(texture))
+		{
+			LOGL::warning("bool MaterialTable::place(PendingLayer& pending) -> %s failed to load, its materials stay grey", pending.texture->path.c_str());
+			return true;
+		}
+
+		int index = findArray(texture, pending.texture->params);
+		if (index < 0)
+			return true;
+		if (m_Arrays[index].layers == m_Arrays[index].capacity)
+		{
+			if (m_Arrays[index].capacity == m_MaxLayers)
+			{
+				LOGL::warning("bool MaterialTable::place(PendingLayer& pending) -> no layer left for %s", pending.texture->path.c_str());
+				return true;
+			}
+			grow(m_Arrays[index]);
+		}
+
+		TextureArray& array = m_Arrays[index];
+		GLint layer = array.layers++;
+		copy(texture, GL_TEXTURE_2D, 1, array, layer);
+		m_Layers[pending.key] = std::make_pair((GLint)index, layer);
+		for (const LayerUser& user : pending.users)
+			assign(user, index, layer);
+		return true;
+	}
+
+	int MaterialTable::findArray(GLuint texture, const TextureParams& params)
+	{
+		GLint width, height, internalFormat, maxLevel;
+		GLState.bindTexture(GL_TEXTURE_2D, texture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+		GLState.bindTexture(GL_TEXTURE_2D, 0);
+		// the streamer sets the max level to the last uploaded mip
+		int levels = maxLevel + 1;
+
+		for (size_t i = 0; i < m_Arrays.size(); i++)
+		{
+			const TextureArray& array = m_Arrays[i];
+			if (array.width == width && array.height == height && array.internalFormat == (GLenum)internalFormat && array.levels == levels &&
+				array.params.wrapS == params.wrapS && array.params.wrapT == params.wrapT &&
+				array.params.minFilter == params.minFilter && array.params.magFilter == params.magFilter)
+				return (int)i;
+		}
+
+		if ((int)m_Arrays.size() == getArrayCount())
+		{
+			LOGL::warning("int MaterialTable::findArray(GLuint texture, const TextureParams& params) -> a %dx%d texture needs more than %d arrays",
+				width, height, getArrayCount());
+			return -1;
+		}
+
+		TextureArray array = { 0, width, height, (GLenum)internalFormat, levels, params, 0, MATERIAL_ARRAY_LAYERS };
+		allocate(array);
+		m_Arrays.push_back(array);
+		return (int)m_Arrays.size() - 1;
+	}
+
+	void MaterialTable::allocate(TextureArray& array)
+	{
+		bool compressed = isCompressed(array.internalFormat);
+		glGenTextures(1, &array.ID);
+		GLState.bindTexture(GL_TEXTURE_2D_ARRAY, array.ID);
+		for (int level = 0; level < array.levels; level++)
+		{
+			int width = std::max(1, array.width >> level);
+			int height = std::max(1, array.height >> level);
+			if (compressed)
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, array.internalFormat, width, height, array.capacity, 0,
+					(GLsizei)(levelSize(array.internalFormat, width, height) * array.capacity), NULL);
+			else
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, array.internalFormat, width, height, array.capacity, 0, pixelFormat(array.internalFormat), GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, array.params.wrapS);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, array.params.wrapT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, array.params.minFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, array.params.magFilter);
+		GLState.bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+
+	void MaterialTable::grow(TextureArray& array)
+	{
+		TextureArray grown = array;
+		grown.capacity = std::min(array.capacity * 2, (int)m_MaxLayers);
+		allocate(grown);
+		copy(array.ID, GL_TEXTURE_2D_ARRAY, array.layers, grown, 0);
+		GLState.deleteTextures(1, &array.ID);
+		array = grown;
+	}
+
+	void MaterialTable::copy(GLuint source, GLenum sourceTarget, int depth, const TextureArray& array, int dstLayer)
+	{
+		if (GLExt.ARB_copy_image)
+		{
+			for (int level = 0; level < array.levels; level++)
+			{
+				int width = std::max(1, array.width >> level);
+				int height = std::max(1, array.height >> level);
+				GLExt.CopyImageSubData(source, sourceTarget, level, 0, 0, 0, array.ID, GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer, width, height, depth);
+			}
+			return;
+		}
+
+		// read back into a pixel pack buffer and unpacked from the same buffer, the texels stay in GPU memory
+		bool compressed = isCompressed(array.internalFormat);
+		GLenum format = pixelFormat(array.internalFormat);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int level = 0; level < array.levels; level++)
+		{
+			int width = std::max(1, array.width >> level);
+			int height = std::max(1, array.height >> level);
+			size_t size = levelSize(array.internalFormat, width, height) * depth;
+
+			// bound per level, growing copies from one GL_TEXTURE_2D_ARRAY into another
+			GLState.bindTexture(sourceTarget, source);
+			GLState.bindBuffer(GL_PIXEL_PACK_BUFFER, m_CopyBuffer);
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_COPY);
+			if (compressed)
+				glGetCompressedTexImage(sourceTarget, level, (void*)0);
+			else
+				glGetTexImage(sourceTarget, level, format, GL_UNSIGNED_BYTE, (void*)0);
+			GLState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			GLState.bindTexture(GL_TEXTURE_2D_ARRAY, array.ID);
+			GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_CopyBuffer);
+			if (compressed)
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer, width, height, depth, array.internalFormat, (GLsizei)size, (void*)0);
+			else
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, dstLayer, width, height, depth, format, GL_UNSIGNED_BYTE, (void*)0);
+			GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		GLState.bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		GLState.bindTexture(sourceTarget, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	void MaterialTable::bind() const
+	{
+		for (size_t i = 0; i < m_Arrays.size(); i++)
+			GLState.bindTextureUnit(MATERIAL_ARRAY_UNIT + (GLuint)i, GL_TEXTURE_2D_ARRAY, m_Arrays[i].ID);
+		GLState.bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, m_UBO);
+	}
+
+	void MaterialTable::setupShader(Shader& shader)
+	{
+		shader.use();
+		for (int i = 0; i < getArrayCount(); i++)
+			shader.setInt("materialArrays[" + std::to_string(i) + "]", MATERIAL_ARRAY_UNIT + i);
+	}
+
+	int MaterialTable::getArrayCount()
+	{
+		static int count = 0;
+		if (!count)
+		{
+			GLint units = 0;
+			glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units);
+			count = std::max(1, std::min(MATERIAL_ARRAY_MAX, units - MATERIAL_ARRAY_UNIT));
+		}
+		return count;
+	}
+
+	MaterialTableStats MaterialTable::getStats() const
+	{
+		MaterialTableStats stats;
+		stats.materials = m_Materials.size();
+		stats.arrays = m_Arrays.size();
+		for (const TextureArray& array : m_Arrays)
+			stats.layers += array.layers;
+		stats.pending = m_Pending.size();
+		return stats;
+	}
+
+	void MaterialTable::clear()
+	{
+		for (TextureArray& array : m_Arrays)
+			GLState.deleteTextures(1, &array.ID);
+		m_Arrays.clear();
+		m_Pending.clear();
+		m_Layers.clear();
+		m_Materials.clear();
+		m_Dirty = false;
+		GLState.deleteBuffers(1, &m_UBO);
+		GLState.deleteBuffers(1, &m_CopyBuffer);
+		m_UBO = 0;
+		m_CopyBuffer = 0;
+	}
+}
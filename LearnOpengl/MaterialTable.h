@@ -0,0 +1,133 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "Shader.h"
+#include "TextureCache.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// std140 array of MaterialStd140 read by materials.glsl, 32 bytes each
+#define MAX_MATERIALS 256
+#define MATERIAL_BINDING 1
+// units 0-6 are taken by the lighting passes, arrays are bound from here on
+#define MATERIAL_ARRAY_UNIT 7
+// samplers materials.glsl can declare; the arrays in use are capped further by
+// GL_MAX_TEXTURE_IMAGE_UNITS, at least 9 as GL 3.3 guarantees 16 units
+#define MATERIAL_ARRAY_MAX 16
+// layers an array starts with, it doubles when full
+#define MATERIAL_ARRAY_LAYERS 4
+
+namespace LOGL
+{
+	struct MaterialDesc
+	{
+		std::string diffuse;
+		std::string specular;
+		float shininess = 32.0f;
+		TextureParams params;
+	};
+
+	// GPU layout of a material, array -1 samples the streaming placeholder
+	struct MaterialStd140
+	{
+		GLint diffuseArray;
+		GLint diffuseLayer;
+		GLint specularArray;
+		GLint specularLayer;
+		float shininess;
+		float padding[3];
+	};
+	static_assert(sizeof(MaterialStd140) == 32, "MaterialStd140 must be two vec4");
+
+	struct MaterialTableStats
+	{
+		size_t materials = 0;
+		size_t arrays = 0;
+		size_t layers = 0;
+		// textures still streaming or waiting for a layer
+		size_t pending = 0;
+	};
+
+	// textures of the same size, format, mip count and sampling share a GL_TEXTURE_2D_ARRAY,
+	// one layer each; materials index their layers through the Materials uniform block, so
+	// a frame binds the arrays once and draws pick their material by InstanceData::material
+	class MaterialTable
+	{
+	public:
+		MaterialTable();
+
+		void init(TextureCache& cache, TextureStreamer& streamer);
+
+		// index for InstanceData::material, grey until both textures are streamed and copied into a layer
+		GLint add(const MaterialDesc& desc);
+
+		// copies textures the streamer finished into their layers, uploads changed materials;
+		// call on the GL thread once per frame after TextureCache::update()
+		void update();
+
+		// binds every array and the material block, draws in between need no texture binds
+		void bind() const;
+
+		// sampler units of a program that includes materials.glsl, the block binding is set by Shader
+		static void setupShader(Shader& shader);
+		// arrays the driver has units for, injected into programs as MATERIAL_ARRAY_COUNT
+		static int getArrayCount();
+
+		MaterialTableStats getStats() const;
+
+		// deletes the arrays and buffers and forgets every material, init() again before reuse
+		void clear();
+	private:
+		struct TextureArray
+		{
+			GLuint ID;
+			int width;
+			int height;
+			GLenum internalFormat;
+			int levels;
+			TextureParams params;
+			int layers;
+			int capacity;
+		};
+
+		struct LayerUser
+		{
+			GLint material;
+			bool specular;
+		};
+
+		// a texture waiting for its layer and the materials that sample it
+		struct PendingLayer
+		{
+			std::shared_ptr<Texture> texture;
+			std::string key;
+			std::vector<LayerUser> users;
+		};
+
+		void request(const std::string& path, const TextureParams& params, LayerUser user);
+		void assign(const LayerUser& user, GLint array, GLint layer);
+		// false while the texture is streaming, true once it has a layer or failed
+		bool place(PendingLayer& pending);
+		int findArray(GLuint texture, const TextureParams& params);
+		void grow(TextureArray& array);
+		void allocate(TextureArray& array);
+		// levels of source (a 2D texture or the first depth layers of an array) into layer dstLayer of array
+		void copy(GLuint source, GLenum sourceTarget, int depth, const TextureArray& array, int dstLayer);
+
+		TextureCache* m_Cache = nullptr;
+		TextureStreamer* m_Streamer = nullptr;
+		GLuint m_UBO = 0;
+		// pixel pack and unpack buffer of copy() without GL_ARB_copy_image
+		GLuint m_CopyBuffer = 0;
+		GLint m_MaxLayers = 256;
+
+		std::vector<MaterialStd140> m_Materials;
+		bool m_Dirty = false;
+		std::vector<TextureArray> m_Arrays;
+		std::vector<PendingLayer> m_Pending;
+		// TextureCache key -> (array, layer), a texture used by several materials is copied once
+		std::unordered_map<std::string, std::pair<GLint, GLint>> m_Layers;
+	};
+}
@@ -0,0 +1,543 @@
+#include "Mesh.h"
+#include "GLState.h"
+#include "Shader.h"
+#include "logger.h"
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+
+// viewport, frames and draws per frame of benchmarkVertexLayouts()
+#define VERTEX_LAYOUT_BENCH_SIZE 64
+#define VERTEX_LAYOUT_BENCH_FRAMES 5
+#define VERTEX_LAYOUT_BENCH_DRAWS 4
+
+namespace LOGL
+{
+	struct VertexHash
+	{
+		size_t operator()(const Vertex& v) const
+		{
+			// FNV-1a over the raw bytes, welding only merges bitwise equal vertices
+			const unsigned char* bytes = (const unsigned char*)&v;
+			size_t hash = 2166136261u;
+			for (size_t i = 0; i < sizeof(Vertex); i++)
+				hash = (hash ^ bytes[i]) * 16777619u;
+			return hash;
+		}
+	};
+
+	struct VertexEqual
+	{
+		bool operator()(const Vertex& a, const Vertex& b) const
+		{
+			return memcmp(&a, &b, sizeof(Vertex)) == 0;
+		}
+	};
+
+	static uint16_t toHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if (exponent >= 31) // overflow, inf and nan all end up as inf
+			return (uint16_t)(sign | 0x7C00);
+		if (exponent <= 0) // denormal or zero
+		{
+			if (exponent < -10)
+				return (uint16_t)sign;
+			mantissa |= 0x800000;
+			uint32_t shift = 14 - exponent;
+			uint32_t half = mantissa >> shift;
+			// round to nearest
+			if ((mantissa >> (shift - 1)) & 1)
+				half++;
+			return (uint16_t)(sign | half);
+		}
+
+		uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+		// round to nearest, a carry into the exponent is still the right value
+		if (mantissa & 0x1000)
+			half++;
+		return (uint16_t)half;
+	}
+
+	static uint16_t toUnorm16(float value)
+	{
+		return (uint16_t)(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	}
+
+	static uint32_t toSnorm10(float value)
+	{
+		int v = (int)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 511.0f);
+		return (uint32_t)v & 0x3FF;
+	}
+
+	VertexFormat VertexFormat::get(VertexLayout layout)
+	{
+		VertexFormat format;
+		if (layout == VERTEX_LAYOUT_PACKED)
+		{
+			format.stride = sizeof(PackedVertex);
+			format.attribs.push_back({ 0, 4, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, position) });
+			format.attribs.push_back({ 1, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, texture) });
+			format.attribs.push_back({ 2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, normal) });
+		}
+		else
+		{
+			format.stride = sizeof(Vertex);
+			format.attribs.push_back({ 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position) });
+			format.attribs.push_back({ 1, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texture) });
+			format.attribs.push_back({ 2, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal) });
+		}
+		return format;
+	}
+
+	void VertexFormat::apply() const
+	{
+		for (const VertexAttrib& attrib : attribs)
+		{
+			glVertexAttribPointer(attrib.location, attrib.size, attrib.type, attrib.normalized, stride, (void*)attrib.offset);
+			glEnableVertexAttribArray(attrib.location);
+		}
+	}
+
+	void drawMesh(const Mesh& mesh, size_t lod)
+	{
+		GLsizei count = mesh.indexCount;
+		size_t first = 0;
+		if (lod < mesh.lods.size())
+		{
+			count = (GLsizei)mesh.lods[lod].indexCount;
+			first = mesh.lods[lod].firstIndex;
+		}
+
+		size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		GLState.bindVertexArray(mesh.VAO);
+		glDrawElements(GL_TRIANGLES, count, mesh.indexType, (void*)(first * indexSize));
+	}
+
+	MeshBuilder::MeshBuilder()
+	{
+	}
+
+	void MeshBuilder::addTriangles(const Vertex* vertices, size_t count)
+	{
+		if (count % 3)
+			LOGL::warning("void MeshBuilder::addTriangles(const Vertex* vertices, size_t count) -> %d vertices don't form triangles", (int)count);
+
+		for (size_t i = 0; i + 2 < count; i += 3)
+		{
+			for (size_t j = 0; j < 3; j++)
+			{
+				m_Indices.push_back((uint32_t)m_Vertices.size());
+				m_Vertices.push_back(vertices[i + j]);
+			}
+		}
+	}
+
+	MeshData MeshBuilder::finish(VertexLayout layout)
+	{
+		size_t inputVertices = m_Vertices.size();
+		weld();
+		float acmrBefore = m_Logging ? computeACMR(m_Indices, m_Vertices.size()) : 0.0f;
+		optimizeVertexCache();
+		optimizeVertexFetch();
+		if (m_Logging)
+			LOGL::log("MeshData MeshBuilder::finish(VertexLayout layout) -> %d vertices welded to %d, ACMR %.3f -> %.3f",
+				(int)inputVertices, (int)m_Vertices.size(), acmrBefore, computeACMR(m_Indices, m_Vertices.size()));
+
+		MeshData data;
+		data.boundsMin = glm::vec3(m_Vertices.empty() ? 0.0f : INFINITY);
+		data.boundsMax = -data.boundsMin;
+		for (const Vertex& v : m_Vertices)
+		{
+			glm::vec3 position(v.position[0], v.position[1], v.position[2]);
+			data.boundsMin = glm::min(data.boundsMin, position);
+			data.boundsMax = glm::max(data.boundsMax, position);
+			if (layout == VERTEX_LAYOUT_PACKED && (v.texture[0] < 0.0f || v.texture[0] > 1.0f || v.texture[1] < 0.0f || v.texture[1] > 1.0f))
+			{
+				LOGL::warning("MeshData MeshBuilder::finish(VertexLayout layout) -> texture coordinates outside [0, 1], using float vertices");
+				layout = VERTEX_LAYOUT_FLOAT;
+			}
+		}
+
+		data.format = VertexFormat::get(layout);
+		data.vertexCount = m_Vertices.size();
+		if (layout == VERTEX_LAYOUT_PACKED)
+		{
+			pack();
+			data.vertices = m_PackedVertices.data();
+		}
+		else
+			data.vertices = m_Vertices.data();
+
+		data.indexCount = m_Indices.size();
+		data.indexType = m_Vertices.size() <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		if (data.indexType == GL_UNSIGNED_SHORT)
+		{
+			m_ShortIndices.assign(m_Indices.begin(), m_Indices.end());
+			data.indices = m_ShortIndices.data();
+		}
+		else
+			data.indices = m_Indices.data();
+
+		// the builder doesn't simplify, the whole index buffer is the only level
+		data.lods.push_back({ 0, (uint32_t)m_Indices.size(), 0.0f });
+		return data;
+	}
+
+	void MeshBuilder::setLogging(bool enabled)
+	{
+		m_Logging = enabled;
+	}
+
+	Mesh MeshBuilder::build(InstanceBuffer* instances, VertexLayout layout)
+	{
+		return uploadMesh(finish(layout), instances);
+	}
+
+	Mesh uploadMesh(const MeshData& data, InstanceBuffer* instances)
+	{
+		Mesh mesh;
+		mesh.vertexCount = data.vertexCount;
+		mesh.indexCount = data.lods.empty() ? (GLsizei)data.indexCount : (GLsizei)data.lods[0].indexCount;
+		mesh.indexType = data.indexType;
+		mesh.boundsMin = data.boundsMin;
+		mesh.boundsMax = data.boundsMax;
+		mesh.lods = data.lods;
+
+		glGenVertexArrays(1, &mesh.VAO);
+		glGenBuffers(1, &mesh.VBO);
+		glGenBuffers(1, &mesh.EBO);
+		GLState.bindVertexArray(mesh.VAO);
+
+		GLState.bindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+		glBufferData(GL_ARRAY_BUFFER, data.vertexCount * data.format.stride, data.vertices, GL_STATIC_DRAW);
+
+		size_t indexSize = data.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		GLState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indexCount * indexSize, data.indices, GL_STATIC_DRAW);
+
+		data.format.apply();
+
+		// the element buffer binding is VAO state, unbind the VAO first
+		GLState.bindVertexArray(0);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		if (instances)
+			instances->attach(mesh.VAO);
+
+		return mesh;
+	}
+
+	void MeshBuilder::pack()
+	{
+		m_PackedVertices.resize(m_Vertices.size());
+		for (size_t i = 0; i < m_Vertices.size(); i++)
+		{
+			const Vertex& v = m_Vertices[i];
+			PackedVertex& p = m_PackedVertices[i];
+			for (int k = 0; k < 3; k++)
+				p.position[k] = toHalf(v.position[k]);
+			p.position[3] = toHalf(1.0f);
+			p.texture[0] = toUnorm16(v.texture[0]);
+			p.texture[1] = toUnorm16(v.texture[1]);
+			// x in the low bits, w unused
+			p.normal = toSnorm10(v.normal[0]) | (toSnorm10(v.normal[1]) << 10) | (toSnorm10(v.normal[2]) << 20);
+		}
+	}
+
+	void MeshBuilder::weld()
+	{
+		std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> remap(m_Vertices.size());
+		unique.reserve(m_Vertices.size());
+
+		for (size_t i = 0; i < m_Vertices.size(); i++)
+		{
+			auto inserted = unique.insert(std::make_pair(m_Vertices[i], (uint32_t)vertices.size()));
+			if (inserted.second)
+				vertices.push_back(m_Vertices[i]);
+			remap[i] = inserted.first->second;
+		}
+
+		for (uint32_t& index : m_Indices)
+			index = remap[index];
+		m_Vertices.swap(vertices);
+	}
+
+	// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+	static float forsythScore(int cachePosition, int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// the last triangle's vertices get a fixed score so its neighbours aren't preferred over it
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+		// vertices with few triangles left are finished first
+		return score + 2.0f * powf((float)remainingTriangles, -0.5f);
+	}
+
+	void MeshBuilder::optimizeVertexCache()
+	{
+		size_t triangleCount = m_Indices.size() / 3;
+		size_t vertexCount = m_Vertices.size();
+		if (!triangleCount)
+			return;
+
+		// triangles of every vertex, flattened
+		std::vector<int> remaining(vertexCount, 0);
+		for (uint32_t index : m_Indices)
+			remaining[index]++;
+		std::vector<size_t> offsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < vertexCount; i++)
+			offsets[i + 1] = offsets[i] + remaining[i];
+		std::vector<uint32_t> adjacency(m_Indices.size());
+		std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[m_Indices[t * 3 + k]]++] = (uint32_t)t;
+
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			vertexScore[i] = forsythScore(-1, remaining[i]);
+
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		for (size_t t = 0; t < triangleCount; t++)
+			triangleScore[t] = vertexScore[m_Indices[t * 3]] + vertexScore[m_Indices[t * 3 + 1]] + vertexScore[m_Indices[t * 3 + 2]];
+
+		std::vector<uint32_t> output;
+		output.reserve(m_Indices.size());
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> nextCache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		size_t scan = 0;
+		int64_t best = -1;
+
+		while (output.size() < m_Indices.size())
+		{
+			// nothing in the cache has triangles left, take the best remaining one
+			if (best < 0)
+			{
+				float bestScore = -1.0f;
+				for (size_t t = scan; t < triangleCount; t++)
+				{
+					if (!emitted[t] && triangleScore[t] > bestScore)
+					{
+						bestScore = triangleScore[t];
+						best = (int64_t)t;
+					}
+				}
+				while (scan < triangleCount && emitted[scan])
+					scan++;
+			}
+
+			const uint32_t* triangle = &m_Indices[best * 3];
+			emitted[best] = true;
+			nextCache.assign(triangle, triangle + 3);
+			for (int k = 0; k < 3; k++)
+			{
+				output.push_back(triangle[k]);
+				// drop the triangle from its vertices' lists
+				uint32_t v = triangle[k];
+				size_t end = offsets[v] + remaining[v];
+				for (size_t a = offsets[v]; a < end; a++)
+				{
+					if (adjacency[a] == (uint32_t)best)
+					{
+						adjacency[a] = adjacency[end - 1];
+						break;
+					}
+				}
+				remaining[v]--;
+			}
+
+			// LRU: the emitted triangle moves to the front
+			for (uint32_t v : cache)
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					nextCache.push_back(v);
+
+			// rescore the cache and the vertices just pushed out of it, only their triangles changed
+			for (size_t i = 0; i < nextCache.size(); i++)
+			{
+				int position = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+				vertexScore[nextCache[i]] = forsythScore(position, remaining[nextCache[i]]);
+			}
+
+			best = -1;
+			float bestScore = -1.0f;
+			for (uint32_t v : nextCache)
+			{
+				for (size_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+				{
+					uint32_t t = adjacency[a];
+					float score = vertexScore[m_Indices[t * 3]] + vertexScore[m_Indices[t * 3 + 1]] + vertexScore[m_Indices[t * 3 + 2]];
+					triangleScore[t] = score;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+
+			if (nextCache.size() > FORSYTH_CACHE_SIZE)
+				nextCache.resize(FORSYTH_CACHE_SIZE);
+			cache.swap(nextCache);
+		}
+
+		m_Indices.swap(output);
+	}
+
+	void MeshBuilder::optimizeVertexFetch()
+	{
+		// vertices are stored in the order the index buffer first touches them
+		std::vector<uint32_t> remap(m_Vertices.size(), UINT32_MAX);
+		std::vector<Vertex> vertices;
+		vertices.reserve(m_Vertices.size());
+
+		for (uint32_t& index : m_Indices)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = (uint32_t)vertices.size();
+				vertices.push_back(m_Vertices[index]);
+			}
+			index = remap[index];
+		}
+		m_Vertices.swap(vertices);
+	}
+
+	float MeshBuilder::computeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize)
+	{
+		if (indices.size() < 3)
+			return 0.0f;
+
+		// FIFO like most hardware post-transform caches
+		std::vector<int64_t> insertedAt(vertexCount, INT64_MIN / 2);
+		int64_t time = 0;
+		size_t misses = 0;
+		for (uint32_t index : indices)
+		{
+			if (time - insertedAt[index] >= cacheSize)
+			{
+				insertedAt[index] = time++;
+				misses++;
+			}
+		}
+		return (float)misses / (indices.size() / 3);
+	}
+
+	void addSphere(MeshBuilder& builder, int segments)
+	{
+		int rings = std::max(segments / 2, 2);
+		auto point = [segments, rings](int segment, int ring) {
+			float theta = 6.2831853f * segment / segments;
+			float phi = 3.1415927f * ring / rings;
+			float x = std::sin(phi) * std::cos(theta), y = std::cos(phi), z = std::sin(phi) * std::sin(theta);
+			Vertex vertex = { { x, y, z }, { (float)segment / segments, (float)ring / rings }, { x, y, z } };
+			return vertex;
+		};
+
+		std::vector<Vertex> vertices;
+		vertices.reserve((size_t)segments * rings * 6);
+		for (int ring = 0; ring < rings; ring++)
+		{
+			for (int segment = 0; segment < segments; segment++)
+			{
+				Vertex quad[] = {
+					point(segment, ring), point(segment, ring + 1), point(segment + 1, ring + 1),
+					point(segment + 1, ring + 1), point(segment + 1, ring), point(segment, ring)
+				};
+				vertices.insert(vertices.end(), quad, quad + 6);
+			}
+		}
+		builder.addTriangles(vertices.data(), vertices.size());
+	}
+
+	bool benchmarkVertexLayouts(int segments)
+	{
+		if (segments < 3)
+			return false;
+
+		Shader shader("shaders/vertex_benchvs.glsl", "shaders/vertex_benchfs.glsl");
+		if (!shader.isValid())
+			return false;
+		shader.use();
+		// the sphere fills the viewport from a step back
+		glm::mat4 viewProj(1.0f);
+		viewProj[2][2] = -0.5f;
+		viewProj[3][3] = 1.2f;
+		shader.setMat4("viewProj", viewProj);
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glViewport(0, 0, VERTEX_LAYOUT_BENCH_SIZE, VERTEX_LAYOUT_BENCH_SIZE);
+		GLuint timeQuery = 0;
+		glGenQueries(1, &timeQuery);
+
+		const char* names[] = { "float", "packed" };
+		VertexLayout layouts[] = { VERTEX_LAYOUT_FLOAT, VERTEX_LAYOUT_PACKED };
+		for (int i = 0; i < 2; i++)
+		{
+			MeshBuilder builder;
+			builder.setLogging(false);
+			addSphere(builder, segments);
+			MeshData data = builder.finish(layouts[i]);
+			Mesh sphere = uploadMesh(data);
+
+			double seconds = 0.0;
+			GLuint64 gpuNanoseconds = 0;
+			// the first frame uploads and warms up the driver, it isn't counted
+			for (int frame = 0; frame <= VERTEX_LAYOUT_BENCH_FRAMES; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+				auto start = std::chrono::steady_clock::now();
+				for (int draw = 0; draw < VERTEX_LAYOUT_BENCH_DRAWS; draw++)
+					drawMesh(sphere);
+				glEndQuery(GL_TIME_ELAPSED);
+				glFinish();
+				double frameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				GLuint64 nanoseconds = 0;
+				glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &nanoseconds);
+				if (frame > 0)
+				{
+					seconds += frameSeconds;
+					gpuNanoseconds += nanoseconds;
+				}
+			}
+
+			double vertexCount = (double)sphere.indexCount * VERTEX_LAYOUT_BENCH_DRAWS * VERTEX_LAYOUT_BENCH_FRAMES;
+			LOGL::log("bool benchmarkVertexLayouts(int segments) -> %-6s %d vertices, %.2f MB: frame %8.3f ms (%6.1f Mvert/s)  GPU %8.3f ms",
+				names[i], (int)sphere.vertexCount, sphere.vertexCount * data.format.stride / (1024.0 * 1024.0),
+				seconds * 1000.0 / VERTEX_LAYOUT_BENCH_FRAMES, vertexCount / seconds / 1e6, gpuNanoseconds / 1e6 / VERTEX_LAYOUT_BENCH_FRAMES);
+
+			GLuint buffers[] = { sphere.VBO, sphere.EBO };
+			GLState.deleteBuffers(2, buffers);
+			GLState.deleteVertexArrays(1, &sphere.VAO);
+		}
+
+		glDeleteQueries(1, &timeQuery);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		GLState.useProgram(0);
+		GLState.deleteProgram(shader.ID);
+		return true;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "InstanceBuffer.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <cstdint>
+
+// vertices the Forsyth score keeps track of, larger than any real post-transform cache
+#define FORSYTH_CACHE_SIZE 32
+// FIFO size used to report ACMR
+#define ACMR_CACHE_SIZE 16
+
+namespace LOGL
+{
+    struct Vertex
+    {
+        float position[3];
+        float texture[2];
+        float normal[3];
+    };
+
+    // 16 byte alternative to Vertex: half float position (w = 1), unorm16 texture
+    // coordinates and a normal in GL_INT_2_10_10_10_REV; the attribute fetch expands
+    // all three back to floats, so shaders read both layouts the same way
+    struct PackedVertex
+    {
+        uint16_t position[4];
+        uint16_t texture[2];
+        uint32_t normal;
+    };
+    static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+    enum VertexLayout
+    {
+        VERTEX_LAYOUT_FLOAT,
+        VERTEX_LAYOUT_PACKED
+    };
+
+    struct VertexAttrib
+    {
+        GLuint location;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        size_t offset;
+    };
+
+    // describes how a vertex buffer maps to attributes 0-2
+    struct VertexFormat
+    {
+        std::vector<VertexAttrib> attribs;
+        GLsizei stride = 0;
+
+        static VertexFormat get(VertexLayout layout);
+        // sets every attribute of the bound VAO from the bound GL_ARRAY_BUFFER
+        void apply() const;
+    };
+
+    // range of the index buffer drawn from distance on
+    struct MeshLod
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float distance;
+    };
+
+    // CPU side of a mesh, vertices and indices point into storage owned by whoever filled it
+    struct MeshData
+    {
+        VertexFormat format;
+        const void* vertices = nullptr;
+        size_t vertexCount = 0;
+        const void* indices = nullptr;
+        size_t indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_SHORT;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::vector<MeshLod> lods;
+    };
+
+    // uploaded indexed mesh
+    struct Mesh
+    {
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+        GLuint EBO = 0;
+        // index count of lods[0]
+        GLsizei indexCount = 0;
+        // GL_UNSIGNED_SHORT while the vertex count allows it
+        GLenum indexType = GL_UNSIGNED_SHORT;
+        size_t vertexCount = 0;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        std::vector<MeshLod> lods;
+    };
+
+    // with instances the VAO reads per instance attributes from that buffer
+    Mesh uploadMesh(const MeshData& data, InstanceBuffer* instances = nullptr);
+
+    void drawMesh(const Mesh& mesh, size_t lod = 0);
+
+    // collects triangle lists, welds identical vertices and orders
+    // indices for the post-transform cache and vertices for fetch locality
+    class MeshBuilder
+    {
+    public:
+        MeshBuilder();
+        // every three vertices form a triangle
+        void addTriangles(const Vertex* vertices, size_t count);
+        // welds, optimizes and encodes the triangles, the result points into the builder;
+        // VERTEX_LAYOUT_PACKED needs texture coordinates in [0, 1], float is used otherwise
+        MeshData finish(VertexLayout layout = VERTEX_LAYOUT_PACKED);
+        // finish() and uploadMesh()
+        Mesh build(InstanceBuffer* instances = nullptr, VertexLayout layout = VERTEX_LAYOUT_PACKED);
+        // finish() logs the weld and ACMR results unless disabled, for callers building many small meshes
+        void setLogging(bool enabled);
+
+        // average cache misses per triangle of a FIFO cache
+        static float computeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = ACMR_CACHE_SIZE);
+    private:
+        void pack();
+        void weld();
+        void optimizeVertexCache();
+        void optimizeVertexFetch();
+
+        std::vector<Vertex> m_Vertices;
+        std::vector<uint32_t> m_Indices;
+        bool m_Logging = true;
+
+        // encoded by finish()
+        std::vector<PackedVertex> m_PackedVertices;
+        std::vector<uint16_t> m_ShortIndices;
+    };
+
+    // adds a UV sphere of radius 1 around the origin, segments quads around and segments / 2 rings
+    void addSphere(MeshBuilder& builder, int segments);
+
+    // times a sphere of segments in the float and in the packed layout drawn into a 64x64
+    // viewport, where fragments cost next to nothing; logs buffer size and Mvert/s of both
+    bool benchmarkVertexLayouts(int segments);
+}
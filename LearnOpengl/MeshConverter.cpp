@@ -0,0 +1,262 @@
+#include "MeshConverter.h"
+#include "MeshFile.h"
+#include "MappedFile.h"
+#include "GLState.h"
+#include "logger.h"
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <cctype>
+#include <chrono>
+#include <algorithm>
+
+// longest number parseFloats() and parseIndex() read, with the terminator
+#define OBJ_TOKEN_LENGTH 64
+// runs of each path of benchmarkMeshLoad(), the fastest is logged
+#define MESH_BENCH_RUNS 3
+
+namespace LOGL
+{
+	static const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			p++;
+		return p;
+	}
+
+	static const char* nextLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n')
+			p++;
+		return p < end ? p + 1 : end;
+	}
+
+	// the mapping isn't NUL terminated, strtof and strtol read a terminated copy of the token
+	// at p instead; longer tokens than any number are cut and parse as far as they fit
+	static size_t copyToken(const char* p, const char* end, char (&token)[OBJ_TOKEN_LENGTH])
+	{
+		size_t length = 0;
+		while (p + length < end && length < OBJ_TOKEN_LENGTH - 1 && p[length] != ' ' && p[length] != '\t'
+			&& p[length] != '\r' && p[length] != '\n' && p[length] != '/')
+		{
+			token[length] = p[length];
+			length++;
+		}
+		token[length] = '\0';
+		return length;
+	}
+
+	// reads up to count floats of the current line
+	static const char* parseFloats(const char* p, const char* end, float* values, int count)
+	{
+		char token[OBJ_TOKEN_LENGTH];
+		for (int i = 0; i < count; i++)
+		{
+			p = skipSpaces(p, end);
+			copyToken(p, end, token);
+			char* next;
+			values[i] = strtof(token, &next);
+			if (next == token)
+				break;
+			p += next - token;
+		}
+		return p;
+	}
+
+	// OBJ indices are 1 based, negative ones count back from the last element; -1 if absent
+	static const char* parseIndex(const char* p, const char* end, size_t elementCount, int& index)
+	{
+		index = -1;
+		char token[OBJ_TOKEN_LENGTH];
+		copyToken(p, end, token);
+		char* next;
+		long value = strtol(token, &next, 10);
+		if (next == token)
+			return p;
+		if (value > 0)
+			index = (int)value - 1;
+		else if (value < 0)
+			index = (int)elementCount + (int)value;
+		if (index >= (int)elementCount)
+			index = -1;
+		return p + (next - token);
+	}
+
+	bool loadObj(const std::string& path, MeshBuilder& builder)
+	{
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texCoords;
+		std::vector<glm::vec3> normals;
+		// one polygon, fanned into triangles once the line is read
+		std::vector<Vertex> polygon;
+		std::vector<bool> hasNormal;
+		std::vector<Vertex> triangles;
+		size_t invalid = 0;
+
+		const char* p = (const char*)file.data();
+		const char* end = p + file.size();
+		while (p < end)
+		{
+			p = skipSpaces(p, end);
+			if (end - p > 2 && p[0] == 'v' && p[1] == ' ')
+			{
+				glm::vec3 v(0.0f);
+				parseFloats(p + 2, end, &v.x, 3);
+				positions.push_back(v);
+			}
+			else if (end - p > 3 && p[0] == 'v' && p[1] == 't' && p[2] == ' ')
+			{
+				glm::vec2 t(0.0f);
+				parseFloats(p + 3, end, &t.x, 2);
+				texCoords.push_back(t);
+			}
+			else if (end - p > 3 && p[0] == 'v' && p[1] == 'n' && p[2] == ' ')
+			{
+				glm::vec3 n(0.0f);
+				parseFloats(p + 3, end, &n.x, 3);
+				normals.push_back(n);
+			}
+			else if (end - p > 2 && p[0] == 'f' && p[1] == ' ')
+			{
+				polygon.clear();
+				hasNormal.clear();
+				const char* q = p + 2;
+				while (true)
+				{
+					q = skipSpaces(q, end);
+					if (q >= end || *q == '\n' || *q == '#')
+						break;
+
+					int vi, ti = -1, ni = -1;
+					q = parseIndex(q, end, positions.size(), vi);
+					if (q < end && *q == '/')
+					{
+						q++;
+						if (q < end && *q != '/')
+							q = parseIndex(q, end, texCoords.size(), ti);
+						if (q < end && *q == '/')
+							q = parseIndex(q + 1, end, normals.size(), ni);
+					}
+					if (vi < 0)
+					{
+						invalid++;
+						break;
+					}
+					// skip whatever is left of a malformed token
+					while (q < end && *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n')
+						q++;
+
+					Vertex vertex = {};
+					memcpy(vertex.position, &positions[vi].x, sizeof(vertex.position));
+					if (ti >= 0)
+						memcpy(vertex.texture, &texCoords[ti].x, sizeof(vertex.texture));
+					if (ni >= 0)
+						memcpy(vertex.normal, &normals[ni].x, sizeof(vertex.normal));
+					polygon.push_back(vertex);
+					hasNormal.push_back(ni >= 0);
+				}
+
+				for (size_t i = 2; i < polygon.size(); i++)
+				{
+					size_t corners[3] = { 0, i - 1, i };
+					glm::vec3 a(polygon[0].position[0], polygon[0].position[1], polygon[0].position[2]);
+					glm::vec3 b(polygon[i - 1].position[0], polygon[i - 1].position[1], polygon[i - 1].position[2]);
+					glm::vec3 c(polygon[i].position[0], polygon[i].position[1], polygon[i].position[2]);
+					glm::vec3 faceNormal = glm::cross(b - a, c - a);
+					float length = glm::length(faceNormal);
+					faceNormal = length > 0.0f ? faceNormal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+					for (size_t corner : corners)
+					{
+						Vertex vertex = polygon[corner];
+						if (!hasNormal[corner])
+							memcpy(vertex.normal, &faceNormal.x, sizeof(vertex.normal));
+						triangles.push_back(vertex);
+					}
+				}
+			}
+			p = nextLine(p, end);
+		}
+
+		if (invalid)
+			LOGL::warning("bool loadObj(const std::string& path, MeshBuilder& builder) -> skipped %d faces with invalid indices in %s", (int)invalid, path.c_str());
+		if (triangles.empty())
+		{
+			LOGL::error("bool loadObj(const std::string& path, MeshBuilder& builder) -> no faces in %s", path.c_str());
+			return false;
+		}
+
+		builder.addTriangles(triangles.data(), triangles.size());
+		return true;
+	}
+
+	bool convertMesh(const std::string& inputPath, const std::string& outputPath, VertexLayout layout)
+	{
+		size_t dot = inputPath.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : inputPath.substr(dot);
+		for (char& c : extension)
+			c = (char)tolower(c);
+
+		MeshBuilder builder;
+		if (extension == ".obj")
+		{
+			if (!loadObj(inputPath, builder))
+				return false;
+		}
+		else
+		{
+			LOGL::error("bool convertMesh(const std::string& inputPath, const std::string& outputPath, VertexLayout layout) -> %s isn't an OBJ file", inputPath.c_str());
+			return false;
+		}
+
+		MeshData data = builder.finish(layout);
+		if (!saveMesh(outputPath, data))
+			return false;
+
+		LOGL::log("bool convertMesh(const std::string& inputPath, const std::string& outputPath, VertexLayout layout) -> %s: %d vertices, %d triangles",
+			outputPath.c_str(), (int)data.vertexCount, (int)data.indexCount / 3);
+		return true;
+	}
+
+	static void deleteMesh(Mesh& mesh)
+	{
+		GLuint buffers[] = { mesh.VBO, mesh.EBO };
+		GLState.deleteBuffers(2, buffers);
+		GLState.deleteVertexArrays(1, &mesh.VAO);
+	}
+
+	bool benchmarkMeshLoad(const std::string& objPath, const std::string& meshPath)
+	{
+		double objSeconds = 1e30, meshSeconds = 1e30;
+		int triangles = 0;
+		for (int run = 0; run < MESH_BENCH_RUNS; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			MeshBuilder builder;
+			builder.setLogging(false);
+			if (!loadObj(objPath, builder))
+				return false;
+			Mesh mesh = uploadMesh(builder.finish());
+			glFinish();
+			objSeconds = std::min(objSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			triangles = (int)mesh.indexCount / 3;
+			deleteMesh(mesh);
+
+			start = std::chrono::steady_clock::now();
+			if (!loadMesh(meshPath, mesh))
+				return false;
+			glFinish();
+			meshSeconds = std::min(meshSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			deleteMesh(mesh);
+		}
+
+		LOGL::log("bool benchmarkMeshLoad(const std::string& objPath, const std::string& meshPath) -> %d triangles: "
+			"loadObj + finish + uploadMesh %.1f ms, loadMesh %.1f ms (%.1fx)",
+			triangles, objSeconds * 1000.0, meshSeconds * 1000.0, objSeconds / meshSeconds);
+		return true;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Mesh.h"
+#include <string>
+
+namespace LOGL
+{
+	// adds the faces of a Wavefront OBJ, polygons are fanned into triangles;
+	// faces without normals get their face normal, missing texture coordinates are 0
+	bool loadObj(const std::string& path, MeshBuilder& builder);
+
+	// offline conversion to the binary .mesh format, see MeshFile.h
+	bool convertMesh(const std::string& inputPath, const std::string& outputPath, VertexLayout layout = VERTEX_LAYOUT_PACKED);
+
+	// times building and uploading objPath with loadObj() against loading meshPath with loadMesh(),
+	// the best of a few runs each; needs a GL context
+	bool benchmarkMeshLoad(const std::string& objPath, const std::string& meshPath);
+}
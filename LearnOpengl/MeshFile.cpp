@@ -0,0 +1,150 @@
+#include "MeshFile.h"
+#include "MappedFile.h"
+#include "logger.h"
+#include <fstream>
+#include <cstring>
+
+namespace LOGL
+{
+	static uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+	}
+
+	static size_t indexSize(GLenum indexType)
+	{
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	bool saveMesh(const std::string& path, const MeshData& data)
+	{
+		MeshFileHeader header = {};
+		header.magic = MESH_FILE_MAGIC;
+		header.version = MESH_FILE_VERSION;
+		header.vertexCount = (uint32_t)data.vertexCount;
+		header.vertexStride = (uint32_t)data.format.stride;
+		header.indexCount = (uint32_t)data.indexCount;
+		header.indexType = data.indexType;
+		header.attribCount = (uint32_t)data.format.attribs.size();
+		header.lodCount = (uint32_t)data.lods.size();
+		for (int i = 0; i < 3; i++)
+		{
+			header.boundsMin[i] = data.boundsMin[i];
+			header.boundsMax[i] = data.boundsMax[i];
+		}
+
+		uint64_t vertexBytes = (uint64_t)data.vertexCount * data.format.stride;
+		uint64_t indexBytes = (uint64_t)data.indexCount * indexSize(data.indexType);
+		uint64_t tableEnd = sizeof(MeshFileHeader) + header.attribCount * sizeof(MeshFileAttrib) + header.lodCount * sizeof(MeshLod);
+		header.vertexOffset = alignOffset(tableEnd);
+		header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			LOGL::error("bool saveMesh(const std::string& path, const MeshData& data) -> can't write %s", path.c_str());
+			return false;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		for (const VertexAttrib& attrib : data.format.attribs)
+		{
+			MeshFileAttrib record = { attrib.location, (uint32_t)attrib.size, attrib.type, attrib.normalized, (uint32_t)attrib.offset };
+			file.write((const char*)&record, sizeof(record));
+		}
+		if (!data.lods.empty())
+			file.write((const char*)data.lods.data(), data.lods.size() * sizeof(MeshLod));
+
+		static const char padding[MESH_FILE_ALIGNMENT] = {};
+		file.write(padding, header.vertexOffset - tableEnd);
+		file.write((const char*)data.vertices, vertexBytes);
+		file.write(padding, header.indexOffset - header.vertexOffset - vertexBytes);
+		file.write((const char*)data.indices, indexBytes);
+
+		if (!file.good())
+		{
+			LOGL::error("bool saveMesh(const std::string& path, const MeshData& data) -> writing %s failed", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances)
+	{
+		MappedFile file;
+		if (!file.open(path))
+			return false;
+
+		const char* bytes = (const char*)file.data();
+		MeshFileHeader header;
+		if (file.size() < sizeof(header))
+		{
+			LOGL::error("bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances) -> %s is truncated", path.c_str());
+			return false;
+		}
+		memcpy(&header, bytes, sizeof(header));
+
+		if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION)
+		{
+			LOGL::error("bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances) -> %s isn't a version %d mesh file", path.c_str(), MESH_FILE_VERSION);
+			return false;
+		}
+		if (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+		{
+			LOGL::error("bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances) -> %s has an unknown index type", path.c_str());
+			return false;
+		}
+
+		// counts are 32 bit, none of the products can wrap; offsets are checked against the
+		// size before anything is added to them so a corrupt header can't wrap the sums either
+		uint64_t size = file.size();
+		uint64_t tableEnd = sizeof(MeshFileHeader) + (uint64_t)header.attribCount * sizeof(MeshFileAttrib) + (uint64_t)header.lodCount * sizeof(MeshLod);
+		uint64_t vertexBytes = (uint64_t)header.vertexCount * header.vertexStride;
+		uint64_t indexBytes = (uint64_t)header.indexCount * indexSize(header.indexType);
+		if (header.vertexOffset % MESH_FILE_ALIGNMENT || header.indexOffset % MESH_FILE_ALIGNMENT)
+		{
+			LOGL::error("bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances) -> %s has unaligned blobs", path.c_str());
+			return false;
+		}
+		if (header.vertexOffset > size || header.indexOffset > size || tableEnd > header.vertexOffset || header.vertexOffset > header.indexOffset
+			|| vertexBytes > header.indexOffset - header.vertexOffset || indexBytes > size - header.indexOffset)
+		{
+			LOGL::error("bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances) -> %s is truncated", path.c_str());
+			return false;
+		}
+
+		MeshData data;
+		data.format.stride = (GLsizei)header.vertexStride;
+		const char* table = bytes + sizeof(MeshFileHeader);
+		for (uint32_t i = 0; i < header.attribCount; i++)
+		{
+			MeshFileAttrib record;
+			memcpy(&record, table, sizeof(record));
+			table += sizeof(record);
+			data.format.attribs.push_back({ record.location, (GLint)record.size, record.type, (GLboolean)record.normalized, record.offset });
+		}
+		data.lods.resize(header.lodCount);
+		if (header.lodCount)
+			memcpy(data.lods.data(), table, header.lodCount * sizeof(MeshLod));
+		for (const MeshLod& lod : data.lods)
+		{
+			if ((uint64_t)lod.firstIndex + lod.indexCount > header.indexCount)
+			{
+				LOGL::error("bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances) -> %s has a LOD outside its indices", path.c_str());
+				return false;
+			}
+		}
+
+		data.vertices = bytes + header.vertexOffset;
+		data.vertexCount = header.vertexCount;
+		data.indices = bytes + header.indexOffset;
+		data.indexCount = header.indexCount;
+		data.indexType = header.indexType;
+		data.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+		data.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+		// glBufferData reads straight from the mapping, the file is unmapped once it returns
+		mesh = uploadMesh(data, instances);
+		return true;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Mesh.h"
+#include <string>
+
+#define MESH_FILE_MAGIC 0x48534D4C // "LMSH"
+#define MESH_FILE_VERSION 1
+// vertex and index blobs start at multiples of this
+#define MESH_FILE_ALIGNMENT 16
+
+namespace LOGL
+{
+    // .mesh layout, little endian: MeshFileHeader, attribCount MeshFileAttrib,
+    // lodCount MeshLod, then the vertex and index blobs exactly as glBufferData takes them
+    struct MeshFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t vertexStride;
+        uint32_t indexCount;
+        uint32_t indexType;
+        uint32_t attribCount;
+        uint32_t lodCount;
+        float boundsMin[3];
+        float boundsMax[3];
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+    };
+    static_assert(sizeof(MeshFileHeader) == 72, "MeshFileHeader is read straight from disk");
+
+    struct MeshFileAttrib
+    {
+        uint32_t location;
+        uint32_t size;
+        uint32_t type;
+        uint32_t normalized;
+        uint32_t offset;
+    };
+
+    bool saveMesh(const std::string& path, const MeshData& data);
+
+    // maps the file and uploads the blobs without copying them first;
+    // with instances the VAO reads per instance attributes from that buffer
+    bool loadMesh(const std::string& path, Mesh& mesh, InstanceBuffer* instances = nullptr);
+}
@@ -0,0 +1,357 @@
+#include "MipGenerator.h"
+#include "CpuFeatures.h"
+#include "logger.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#define SRGB_ENCODE_TABLE_SIZE 16384
+// rows halved in width kept for the vertical filter, a power of two above its taps
+#define MIP_FILTER_RING_SIZE 8
+
+namespace LOGL
+{
+	static float besselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// weights of the source texels at -2.5 .. 2.5 from an output texel's center
+	static void kaiserWeights(float* weights)
+	{
+		const float pi = 3.14159265f;
+		float sum = 0.0f;
+		for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+		{
+			float d = i - MIP_FILTER_RADIUS + 0.5f;
+			// half band sinc, the output is sampled at half the source rate
+			float t = d * 0.5f;
+			float sinc = std::sin(pi * t) / (pi * t);
+			float r = d / MIP_FILTER_RADIUS;
+			float window = besselI0(MIP_KAISER_BETA * std::sqrt(std::max(0.0f, 1.0f - r * r))) / besselI0(MIP_KAISER_BETA);
+			weights[i] = sinc * window;
+			sum += weights[i];
+		}
+		for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+			weights[i] /= sum;
+	}
+
+	static float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float linearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// one RGBA float texel per source texel, rows bottom up
+	struct MipLevel
+	{
+		int width;
+		int height;
+		std::vector<float> texels;
+	};
+
+	// output texel x of a row halved in width, taps past the edges repeat the edge texel
+	static void filterTexelClamped(const float* row, int width, int x, const float* weights, float* out)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+		{
+			int sx = std::min(std::max(2 * x + 1 - MIP_FILTER_RADIUS + i, 0), width - 1);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(row + sx * 4)));
+		}
+		_mm_storeu_ps(out, sum);
+	}
+
+	// halves the width of one row of 4 floats per texel
+	static void filterRowSSE(const float* row, int width, float* out, int outWidth, const float* weights)
+	{
+		__m128 w[2 * MIP_FILTER_RADIUS];
+		for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+			w[i] = _mm_set1_ps(weights[i]);
+
+		for (int x = 0; x < outWidth; x++)
+		{
+			int first = 2 * x + 1 - MIP_FILTER_RADIUS;
+			if (first < 0 || first + 2 * MIP_FILTER_RADIUS > width)
+			{
+				filterTexelClamped(row, width, x, weights, out + x * 4);
+				continue;
+			}
+
+			const float* taps = row + first * 4;
+			__m128 sum = _mm_setzero_ps();
+			for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(w[i], _mm_loadu_ps(taps + i * 4)));
+			_mm_storeu_ps(out + x * 4, sum);
+		}
+	}
+
+	// one output row from the 2 * MIP_FILTER_RADIUS rows around it, already halved in width
+	static void filterColumnSSE(const float* const* rows, size_t rowFloats, const float* weights, float* out)
+	{
+		for (size_t x = 0; x < rowFloats; x += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(rows[i] + x)));
+			_mm_storeu_ps(out + x, sum);
+		}
+	}
+
+	TARGET_AVX2 static void filterRowAVX2(const float* row, int width, float* out, int outWidth, const float* weights)
+	{
+		__m256 w[2 * MIP_FILTER_RADIUS];
+		for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+			w[i] = _mm256_set1_ps(weights[i]);
+
+		// two output texels per iteration, their taps are two source texels apart;
+		// the first and last texels clamp
+		filterTexelClamped(row, width, 0, weights, out);
+		int x = 1;
+		for (; x + 1 < outWidth && 2 * x + 3 + MIP_FILTER_RADIUS <= width; x += 2)
+		{
+			const float* taps = row + (2 * x + 1 - MIP_FILTER_RADIUS) * 4;
+			__m256 sum = _mm256_setzero_ps();
+			for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+				sum = _mm256_fmadd_ps(w[i], _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(taps + i * 4)), _mm_loadu_ps(taps + i * 4 + 8), 1), sum);
+			_mm256_storeu_ps(out + x * 4, sum);
+		}
+		for (; x < outWidth; x++)
+			filterTexelClamped(row, width, x, weights, out + x * 4);
+	}
+
+	TARGET_AVX2 static void filterColumnAVX2(const float* const* rows, size_t rowFloats, const float* weights, float* out)
+	{
+		size_t x = 0;
+		for (; x + 8 <= rowFloats; x += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+				sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[i]), _mm256_loadu_ps(rows[i] + x), sum);
+			_mm256_storeu_ps(out + x, sum);
+		}
+		// a row of an odd width ends on one texel
+		for (; x < rowFloats; x += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+				sum = _mm_fmadd_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(rows[i] + x), sum);
+			_mm_storeu_ps(out + x, sum);
+		}
+	}
+
+	static void clampTexels(MipLevel& level)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		for (size_t i = 0; i < level.texels.size(); i += 4)
+			_mm_storeu_ps(&level.texels[i], _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&level.texels[i]), zero), one));
+	}
+
+	// back to 8 bits, sRGB encoded color through the table if decode
+	static void encodeLevel(const MipLevel& level, int channels, bool decode, const unsigned char* toSrgb, unsigned char* out)
+	{
+		// table indices for color, 8 bit values for alpha
+		__m128 scale = decode ? _mm_setr_ps(SRGB_ENCODE_TABLE_SIZE - 1, SRGB_ENCODE_TABLE_SIZE - 1, SRGB_ENCODE_TABLE_SIZE - 1, 255.0f) : _mm_set1_ps(255.0f);
+		size_t count = (size_t)level.width * level.height;
+		for (size_t i = 0; i < count; i++)
+		{
+			// rounds to nearest, the texels are clamped to [0, 1]
+			alignas(16) int32_t values[4];
+			_mm_store_si128((__m128i*)values, _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&level.texels[i * 4]), scale)));
+			for (int c = 0; c < channels; c++)
+				out[i * channels + c] = decode && c < 3 ? toSrgb[values[c]] : (unsigned char)values[c];
+		}
+	}
+
+	// share of texels whose alpha times scale passes reference
+	static float coverageAt(const MipLevel& level, float reference, float scale)
+	{
+		size_t passed = 0;
+		size_t count = (size_t)level.width * level.height;
+		for (size_t i = 0; i < count; i++)
+			passed += level.texels[i * 4 + 3] * scale > reference;
+		return (float)passed / count;
+	}
+
+	// scales alpha so the coverage at reference matches coverage, bisecting the scale
+	static void preserveCoverage(MipLevel& level, float reference, float coverage)
+	{
+		float low = 0.0f;
+		float high = 4.0f;
+		for (int iteration = 0; iteration < 12; iteration++)
+		{
+			float scale = (low + high) * 0.5f;
+			if (coverageAt(level, reference, scale) < coverage)
+				low = scale;
+			else
+				high = scale;
+		}
+
+		// coverage is a step function of the scale, take the side closer to it
+		float scale = std::fabs(coverageAt(level, reference, low) - coverage) < std::fabs(coverageAt(level, reference, high) - coverage) ? low : high;
+		size_t count = (size_t)level.width * level.height;
+		for (size_t i = 0; i < count; i++)
+			level.texels[i * 4 + 3] = std::min(1.0f, level.texels[i * 4 + 3] * scale);
+	}
+
+	bool generateMipChain(TextureImage& image, bool srgb, float alphaCoverage)
+	{
+		int channels = 0;
+		switch (image.format)
+		{
+		case GL_RED: channels = 1; break;
+		case GL_RG: channels = 2; break;
+		case GL_RGB: channels = 3; break;
+		case GL_RGBA: channels = 4; break;
+		}
+		if (!channels || image.levels.size() != 1)
+		{
+			LOGL::error("bool generateMipChain(TextureImage& image, bool srgb, float alphaCoverage) -> needs a single level 8 bit image");
+			return false;
+		}
+
+		static const bool avx2 = hasAVX2();
+		float weights[2 * MIP_FILTER_RADIUS];
+		kaiserWeights(weights);
+
+		// red and red green images hold data, not color
+		bool decode = srgb && channels >= 3;
+		// per channel, alpha is never gamma encoded
+		float toLinear[4][256];
+		for (int i = 0; i < 256; i++)
+		{
+			float value = decode ? srgbToLinear(i / 255.0f) : i / 255.0f;
+			toLinear[0][i] = toLinear[1][i] = toLinear[2][i] = value;
+			toLinear[3][i] = i / 255.0f;
+		}
+		static std::vector<unsigned char> toSrgb;
+		static std::once_flag toSrgbReady;
+		std::call_once(toSrgbReady, []
+		{
+			toSrgb.resize(SRGB_ENCODE_TABLE_SIZE);
+			for (int i = 0; i < SRGB_ENCODE_TABLE_SIZE; i++)
+				toSrgb[i] = (unsigned char)(linearToSrgb(i / (float)(SRGB_ENCODE_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+		});
+
+		const TextureLevel& base = image.levels[0];
+		const unsigned char* pixels = image.data.get() + base.offset;
+		bool coverage = alphaCoverage > 0.0f && channels == 4;
+		float baseCoverage = 0.0f;
+		if (coverage)
+		{
+			size_t passed = 0;
+			for (size_t i = 0; i < (size_t)base.width * base.height; i++)
+				passed += pixels[i * 4 + 3] / 255.0f > alphaCoverage;
+			baseCoverage = (float)passed / ((size_t)base.width * base.height);
+		}
+
+		// level sizes first so the result is one allocation
+		std::vector<TextureLevel> levels;
+		size_t size = 0;
+		for (int w = base.width, h = base.height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+		{
+			levels.push_back({ w, h, size, (size_t)w * h * channels });
+			size += levels.back().size;
+			if (w == 1 && h == 1)
+				break;
+		}
+		std::shared_ptr<unsigned char> data(new unsigned char[size], std::default_delete<unsigned char[]>());
+		memcpy(data.get(), pixels, base.size);
+
+		// level 0 is decoded a row at a time instead of into a float copy of the whole image,
+		// rows halved in width live in a ring only as long as the vertical filter reads them
+		std::vector<float> decoded((size_t)base.width * 4, 1.0f);
+		std::vector<float> ring;
+		int ringRows[MIP_FILTER_RING_SIZE];
+		MipLevel level = { base.width, base.height, std::vector<float>() };
+		MipLevel next;
+		for (size_t l = 1; l < levels.size(); l++)
+		{
+			next.width = levels[l].width;
+			next.height = levels[l].height;
+			next.texels.resize((size_t)next.width * next.height * 4);
+			size_t rowFloats = (size_t)next.width * 4;
+			ring.resize(rowFloats * MIP_FILTER_RING_SIZE);
+			std::fill(ringRows, ringRows + MIP_FILTER_RING_SIZE, -1);
+
+			// source row y halved in width, a side that is already 1 texel only repeats its edge
+			auto filteredRow = [&](int y) -> const float*
+			{
+				float* out = ring.data() + (y % MIP_FILTER_RING_SIZE) * rowFloats;
+				if (ringRows[y % MIP_FILTER_RING_SIZE] == y)
+					return out;
+				ringRows[y % MIP_FILTER_RING_SIZE] = y;
+
+				const float* row;
+				if (l == 1)
+				{
+					const unsigned char* source = pixels + (size_t)y * base.width * channels;
+					if (channels == 4)
+					{
+						for (int x = 0; x < base.width; x++)
+						{
+							decoded[x * 4] = toLinear[0][source[x * 4]];
+							decoded[x * 4 + 1] = toLinear[1][source[x * 4 + 1]];
+							decoded[x * 4 + 2] = toLinear[2][source[x * 4 + 2]];
+							decoded[x * 4 + 3] = toLinear[3][source[x * 4 + 3]];
+						}
+					}
+					else
+					{
+						for (int x = 0; x < base.width; x++)
+							for (int c = 0; c < channels; c++)
+								decoded[x * 4 + c] = toLinear[c][source[x * channels + c]];
+					}
+					row = decoded.data();
+				}
+				else
+					row = level.texels.data() + (size_t)y * level.width * 4;
+
+				if (avx2)
+					filterRowAVX2(row, level.width, out, next.width, weights);
+				else
+					filterRowSSE(row, level.width, out, next.width, weights);
+				return out;
+			};
+
+			for (int y = 0; y < next.height; y++)
+			{
+				const float* rows[2 * MIP_FILTER_RADIUS];
+				for (int i = 0; i < 2 * MIP_FILTER_RADIUS; i++)
+					rows[i] = filteredRow(std::min(std::max(2 * y + 1 - MIP_FILTER_RADIUS + i, 0), level.height - 1));
+
+				float* out = next.texels.data() + y * rowFloats;
+				if (avx2)
+					filterColumnAVX2(rows, rowFloats, weights, out);
+				else
+					filterColumnSSE(rows, rowFloats, weights, out);
+			}
+			std::swap(level, next);
+
+			// the negative lobes ring past [0, 1]
+			clampTexels(level);
+			if (coverage)
+				preserveCoverage(level, alphaCoverage, baseCoverage);
+			encodeLevel(level, channels, decode, toSrgb.data(), data.get() + levels[l].offset);
+		}
+
+		image.levels = levels;
+		image.data = data;
+		return true;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "TextureFile.h"
+
+// support of the Kaiser windowed sinc in source texels, six taps per output texel
+#define MIP_FILTER_RADIUS 3
+#define MIP_KAISER_BETA 4.0f
+
+namespace LOGL
+{
+    // replaces the single level of an 8 bit R, RG, RGB or RGBA image with a full mip chain
+    // filtered in linear space; with srgb the color of RGB and RGBA images is decoded first,
+    // alphaCoverage > 0 rescales the alpha of every level so the share of texels passing
+    // an alpha test against it stays that of level 0. SSE, AVX2 when the CPU has it
+    bool generateMipChain(TextureImage& image, bool srgb = true, float alphaCoverage = 0.0f);
+}
@@ -0,0 +1,267 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <utility>
+
+namespace LOGL
+{
+	static const int RADIX_DIGITS = 64 / RENDER_SORT_RADIX_BITS;
+	static const size_t RADIX_BUCKETS = (size_t)1 << RENDER_SORT_RADIX_BITS;
+
+	static inline uint64_t field(uint64_t value, int bits)
+	{
+		return value & (((uint64_t)1 << bits) - 1);
+	}
+
+	RenderQueue::RenderQueue()
+	{
+	}
+
+	uint64_t RenderQueue::makeKey(unsigned int pass, GLuint program, GLint material, GLuint vao, float depth)
+	{
+		// bits of a positive float grow with its value, dropping the mantissa LSB leaves 30 of them
+		uint32_t depthBits = 0;
+		if (depth > 0.0f)
+			std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+		uint64_t key = field(pass, RENDER_KEY_PASS_BITS);
+		key = (key << RENDER_KEY_PROGRAM_BITS) | field(program, RENDER_KEY_PROGRAM_BITS);
+		key = (key << RENDER_KEY_MATERIAL_BITS) | field((uint32_t)material, RENDER_KEY_MATERIAL_BITS);
+		key = (key << RENDER_KEY_VAO_BITS) | field(vao, RENDER_KEY_VAO_BITS);
+		key = (key << RENDER_KEY_DEPTH_BITS) | field(depthBits >> 1, RENDER_KEY_DEPTH_BITS);
+		return key;
+	}
+
+	void RenderQueue::submit(uint64_t key, const RenderCommand& command)
+	{
+		m_Keys.push_back(key);
+		m_Commands.push_back(command);
+	}
+
+	void RenderQueue::submit(unsigned int pass, const Mesh& mesh, const glm::mat4& model, GLint material, float depth, GLuint program)
+	{
+		RenderCommand command;
+		command.program = program;
+		command.vao = mesh.VAO;
+		command.material = material;
+		command.indexCount = mesh.lods.empty() ? mesh.indexCount : (GLsizei)mesh.lods[0].indexCount;
+		command.indexType = mesh.indexType;
+		command.firstIndex = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+		command.model = model;
+		submit(makeKey(pass, program, material, mesh.VAO, depth), command);
+	}
+
+	void RenderQueue::submitInstanced(unsigned int pass, const Mesh& mesh, InstanceBuffer& instanceBuffer, const InstanceData* instances, size_t count,
+		GLint material, float depth, GLuint program)
+	{
+		if (!count)
+			return;
+
+		RenderCommand command;
+		command.program = program;
+		command.vao = mesh.VAO;
+		command.material = material;
+		command.indexCount = mesh.lods.empty() ? mesh.indexCount : (GLsizei)mesh.lods[0].indexCount;
+		command.indexType = mesh.indexType;
+		command.firstIndex = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+		command.instanceBuffer = &instanceBuffer;
+		command.instances = instances;
+		command.instanceCount = count;
+		submit(makeKey(pass, program, material, mesh.VAO, depth), command);
+	}
+
+	void RenderQueue::sort()
+	{
+		size_t count = m_Keys.size();
+		m_Order.resize(count);
+		m_SortKeys.resize(count);
+		m_SortOrder.resize(count);
+		for (size_t i = 0; i < count; i++)
+			m_Order[i] = (uint32_t)i;
+
+		// histograms of every digit in one read of the keys
+		uint32_t histograms[RADIX_DIGITS][RADIX_BUCKETS] = {};
+		for (uint64_t key : m_Keys)
+		{
+			for (int digit = 0; digit < RADIX_DIGITS; digit++)
+				histograms[digit][field(key >> (digit * RENDER_SORT_RADIX_BITS), RENDER_SORT_RADIX_BITS)]++;
+		}
+
+		// least significant digit first, each pass is stable
+		for (int digit = 0; digit < RADIX_DIGITS; digit++)
+		{
+			int shift = digit * RENDER_SORT_RADIX_BITS;
+			uint32_t* histogram = histograms[digit];
+			if (histogram[field(m_Keys[0] >> shift, RENDER_SORT_RADIX_BITS)] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (size_t bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+			{
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				uint32_t position = histogram[field(m_Keys[i] >> shift, RENDER_SORT_RADIX_BITS)]++;
+				m_SortKeys[position] = m_Keys[i];
+				m_SortOrder[position] = m_Order[i];
+			}
+			std::swap(m_Keys, m_SortKeys);
+			std::swap(m_Order, m_SortOrder);
+			m_Stats.sortPasses++;
+		}
+	}
+
+	void RenderQueue::execute()
+	{
+		m_Stats = RenderQueueStats();
+		if (m_Keys.empty())
+			return;
+		sort();
+
+		// program 0 commands draw with the program the pass bound
+		GLuint passProgram = GLState.getProgram();
+		GLuint program = passProgram;
+		GLuint vao = 0;
+		bool vaoBound = false;
+		GLint material = 0;
+		bool materialSet = false;
+
+		for (uint32_t index : m_Order)
+		{
+			const RenderCommand& command = m_Commands[index];
+			GLuint commandProgram = command.program ? command.program : passProgram;
+			if (commandProgram != program)
+			{
+				GLState.useProgram(commandProgram);
+				program = commandProgram;
+				m_Stats.programChanges++;
+			}
+			else
+				m_Stats.programsSkipped++;
+
+			if (!vaoBound || command.vao != vao)
+			{
+				GLState.bindVertexArray(command.vao);
+				vao = command.vao;
+				vaoBound = true;
+				m_Stats.vaoChanges++;
+			}
+			else
+				m_Stats.vaosSkipped++;
+
+			size_t indexSize = command.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+			void* offset = (void*)(command.firstIndex * indexSize);
+			if (command.instanceBuffer)
+			{
+				command.instanceBuffer->upload(command.instances, command.instanceCount);
+				glDrawElementsInstanced(GL_TRIANGLES, command.indexCount, command.indexType, offset, (GLsizei)command.instanceCount);
+				// the current value of an attribute read from an array is undefined after the draw
+				materialSet = false;
+			}
+			else
+			{
+				if (!materialSet || command.material != material)
+				{
+					setInstanceMaterial(command.material);
+					material = command.material;
+					materialSet = true;
+					m_Stats.materialChanges++;
+				}
+				else
+					m_Stats.materialsSkipped++;
+				setInstanceModel(command.model);
+				glDrawElements(GL_TRIANGLES, command.indexCount, command.indexType, offset);
+			}
+			m_Stats.draws++;
+		}
+
+		if (program != passProgram)
+			GLState.useProgram(passProgram);
+		m_Keys.clear();
+		m_Commands.clear();
+	}
+
+	const RenderQueueStats& RenderQueue::getStats() const
+	{
+		return m_Stats;
+	}
+
+	size_t RenderQueue::getCount() const
+	{
+		return m_Keys.size();
+	}
+
+	bool benchmarkInstancing(int count, const Mesh& mesh, const Mesh& instancedMesh, InstanceBuffer& instanceBuffer, GLint material)
+	{
+		if (count <= 0)
+			return false;
+
+		// a wall of small cubes in front of the scene's camera, every one of them on screen
+		int side = (int)std::ceil(std::sqrt((double)count));
+		float spacing = 16.0f / side;
+		std::vector<InstanceData> instances(count);
+		for (int i = 0; i < count; i++)
+		{
+			glm::vec3 position((i % side - side / 2) * spacing, (i / side - side / 2) * spacing * 0.5625f, -10.0f);
+			glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(spacing * 0.5f));
+			instances[i] = makeInstance(model, material);
+		}
+
+		RenderQueue queue;
+		GLuint timeQuery = 0;
+		glGenQueries(1, &timeQuery);
+
+		const char* paths[] = { "a draw each", "submitInstanced" };
+		for (int path = 0; path < 2; path++)
+		{
+			double cpuSeconds = 0.0;
+			double frameSeconds = 0.0;
+			GLuint64 gpuNanoseconds = 0;
+			// the first frame uploads and warms up the driver, it isn't counted
+			for (int frame = 0; frame <= INSTANCE_BENCH_FRAMES; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+				auto start = std::chrono::steady_clock::now();
+				if (path == 0)
+				{
+					for (int i = 0; i < count; i++)
+					{
+						setInstanceAttribs(instances[i]);
+						drawMesh(mesh);
+					}
+				}
+				else
+				{
+					queue.submitInstanced(0, instancedMesh, instanceBuffer, instances.data(), instances.size(), material, 0.0f);
+					queue.execute();
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				glEndQuery(GL_TIME_ELAPSED);
+				glFinish();
+				double finished = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				GLuint64 nanoseconds = 0;
+				glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &nanoseconds);
+				if (frame > 0)
+				{
+					cpuSeconds += seconds;
+					frameSeconds += finished;
+					gpuNanoseconds += nanoseconds;
+				}
+			}
+			LOGL::log("bool benchmarkInstancing(int count, const Mesh& mesh, const Mesh& instancedMesh, InstanceBuffer& instanceBuffer, GLint material) -> %d cubes, %-16s CPU %8.3f ms  frame %8.3f ms  GPU %8.3f ms",
+				count, paths[path], cpuSeconds * 1000.0 / INSTANCE_BENCH_FRAMES, frameSeconds * 1000.0 / INSTANCE_BENCH_FRAMES,
+				gpuNanoseconds / 1e6 / INSTANCE_BENCH_FRAMES);
+		}
+
+		glDeleteQueries(1, &timeQuery);
+		return true;
+	}
+}
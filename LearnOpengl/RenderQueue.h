@@ -0,0 +1,96 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include <vector>
+#include <cstdint>
+
+// sort key, most significant first: pass | program | material | VAO | depth;
+// program and VAO take the low bits of their GL names, a collision only costs
+// a state change as the command keeps the full name
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_PROGRAM_BITS 10
+#define RENDER_KEY_MATERIAL_BITS 8
+#define RENDER_KEY_VAO_BITS 12
+#define RENDER_KEY_DEPTH_BITS 30
+// radix sort digit, 8 passes at most over the 64 bit keys
+#define RENDER_SORT_RADIX_BITS 8
+// frames every path of benchmarkInstancing is timed over
+#define INSTANCE_BENCH_FRAMES 10
+
+namespace LOGL
+{
+    // what a draw needs once its key has been sorted
+    struct RenderCommand
+    {
+        // 0 draws with whatever program the pass bound before execute()
+        GLuint program = 0;
+        GLuint vao = 0;
+        GLint material = 0;
+        GLsizei indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_SHORT;
+        uint32_t firstIndex = 0;
+        // set for instanced draws, instances are uploaded right before the draw and must
+        // stay valid until execute(); model and material come from the instances then
+        InstanceBuffer* instanceBuffer = nullptr;
+        const InstanceData* instances = nullptr;
+        size_t instanceCount = 0;
+        glm::mat4 model;
+    };
+
+    struct RenderQueueStats
+    {
+        size_t draws = 0;
+        size_t programChanges = 0;
+        size_t vaoChanges = 0;
+        size_t materialChanges = 0;
+        // binds and attribute updates execute() skipped because the state was already set
+        size_t programsSkipped = 0;
+        size_t vaosSkipped = 0;
+        size_t materialsSkipped = 0;
+        // radix passes that ran, digits every key shares are skipped
+        size_t sortPasses = 0;
+    };
+
+    // draws are submitted in any order and executed sorted by key, so draws sharing
+    // a program, material and VAO run back to back and opaque ones front to back
+    class RenderQueue
+    {
+    public:
+        RenderQueue();
+
+        // depth is the distance to the camera, negative values count as 0
+        static uint64_t makeKey(unsigned int pass, GLuint program, GLint material, GLuint vao, float depth);
+
+        void submit(uint64_t key, const RenderCommand& command);
+        // lod 0 of mesh with constant instance attributes
+        void submit(unsigned int pass, const Mesh& mesh, const glm::mat4& model, GLint material, float depth, GLuint program = 0);
+        // every instance in one draw, mesh must have been built with instanceBuffer; material only sorts
+        void submitInstanced(unsigned int pass, const Mesh& mesh, InstanceBuffer& instanceBuffer, const InstanceData* instances, size_t count,
+            GLint material, float depth, GLuint program = 0);
+
+        // sorts, draws and empties the queue; the last VAO stays bound
+        void execute();
+
+        // counters of the last execute()
+        const RenderQueueStats& getStats() const;
+        size_t getCount() const;
+    private:
+        void sort();
+
+        std::vector<uint64_t> m_Keys;
+        std::vector<RenderCommand> m_Commands;
+        // command index of every key after sort()
+        std::vector<uint32_t> m_Order;
+        // radix sort scratch
+        std::vector<uint64_t> m_SortKeys;
+        std::vector<uint32_t> m_SortOrder;
+        RenderQueueStats m_Stats;
+    };
+
+    // times count copies of mesh drawn with the bound program one setInstanceAttribs() + drawMesh()
+    // at a time and with one submitInstanced() of instancedMesh, the same mesh built with instanceBuffer
+    bool benchmarkInstancing(int count, const Mesh& mesh, const Mesh& instancedMesh, InstanceBuffer& instanceBuffer, GLint material);
+}
\ No newline at end of file
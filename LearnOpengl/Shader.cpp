@@ -1,32 +1,59 @@
 #include "Shader.h"
+#include "FrameConstants.h"
+#include "MaterialTable.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "ShaderWatcher.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#define SHADER_CACHE_DIR "shadercache/"
+#define PROGRAM_BINARY_MAGIC 0x4C474F4C // "LOGL"
 
 namespace LOGL
 {
+	struct ProgramBinaryHeader
+	{
+		uint32_t magic;
+		GLenum format;
+		uint32_t length;
+	};
+
+	// value of one active uniform, carried over to a reloaded program
+	struct UniformValue
+	{
+		GLenum type;
+		GLint location;
+		GLint values[16];
+	};
+
+	static std::unordered_map<std::string, std::shared_ptr<Shader>> s_Variants;
+	static ShaderWatcher s_Watcher;
+
 	std::string Shader::readFile(const char* filePath)
 	{
 		std::ifstream file(filePath);
-		file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-		try
+		if (!file.is_open())
 		{
-			std::string str;
-			std::string file_contents;
-			while (!file.eof())
-			{
-				std::getline(file, str);
-				file_contents += str;
-				file_contents.push_back('\n');
-			}
-			file.close();
-			return file_contents;
-		}
-		catch (std::ifstream::failure& e)
-		{
-			LOGL::error("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ");
+			LOGL::error("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: %s", filePath);
+			return std::string();
 		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		return stream.str();
 	}
 
-	void Shader::checkCompileErrors(GLuint shader, const std::string& type)
+	bool Shader::checkCompileErrors(GLuint shader, const std::string& type)
 	{
 		int success;
 		char infoLog[1024];
@@ -48,79 +75,668 @@ namespace LOGL
 				LOGL::error("ERROR::PROGRAM_LINKING_ERROR of type: %s\n%s", type.c_str(), infoLog);
 			}
 		}
+		return success != 0;
 	}
 
-	Shader::Shader(const char* vertexPath, const char* fragmentPath)
+	std::string Shader::preprocess(const std::string& filePath, std::set<std::string>& included)
 	{
-		std::string vShaderStr;
-		std::string fShaderStr;
-		try
+		if (!included.insert(filePath).second)
+			return std::string();
+
+		std::string source = readFile(filePath.c_str());
+		std::string dir = filePath.substr(0, filePath.find_last_of("/\\") + 1);
+
+		std::stringstream in(source);
+		std::string out;
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(in, line))
 		{
-			vShaderStr = readFile(vertexPath);
-			fShaderStr = readFile(fragmentPath);
+			lineNumber++;
+			size_t first = line.find_first_not_of(" \t");
+			if (first == std::string::npos || line.compare(first, 8, "#include") != 0)
+			{
+				out += line + "\n";
+				continue;
+			}
+
+			size_t open = line.find('"', first);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close == std::string::npos)
+			{
+				LOGL::error("std::string Shader::preprocess(const std::string& filePath, std::set<std::string>& included) -> %s:%d malformed #include", filePath.c_str(), lineNumber);
+				continue;
+			}
+
+			// #line keeps compiler errors pointing at the right line of each file
+			out += "#line 1\n";
+			out += preprocess(dir + line.substr(open + 1, close - open - 1), included);
+			out += "#line " + std::to_string(lineNumber + 1) + "\n";
 		}
-		catch (std::ifstream::failure& e)
+		return out;
+	}
+
+	std::string Shader::injectDefines(const std::string& source, const ShaderDefines& defines)
+	{
+		if (defines.empty())
+			return source;
+
+		// #version has to stay the first statement
+		size_t version = source.find("#version");
+		size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+		insert = insert == std::string::npos ? source.size() : insert + 1;
+
+		std::string block;
+		for (const auto& define : defines)
+			block += "#define " + define.first + " " + define.second + "\n";
+		block += "#line 2\n";
+		return source.substr(0, insert) + block + source.substr(insert);
+	}
+
+	std::shared_ptr<Shader> Shader::getVariant(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, bool async)
+	{
+		// defines are sorted, equal sets give equal keys
+		std::string key = std::string(vertexPath) + "|" + fragmentPath + "|";
+		for (const auto& define : defines)
+			key += define.first + "=" + define.second + ";";
+
+		auto it = s_Variants.find(key);
+		if (it != s_Variants.end())
+		{
+			// a variant submitted async earlier is finished for synchronous callers; isReady()
+			// would return false while GL_KHR_parallel_shader_compile is still linking it
+			if (!async && it->second->m_Pending)
+				it->second->finish();
+			return it->second;
+		}
+
+		auto shader = std::make_shared<Shader>(vertexPath, fragmentPath, defines, async);
+		s_Variants[key] = shader;
+		return shader;
+	}
+
+	Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines, bool async)
+		: m_VertexPath(vertexPath), m_FragmentPath(fragmentPath), m_Defines(defines)
+	{
+		submit();
+
+		// querying any status makes the driver wait for the compile
+		if (!async)
+			finish();
+	}
+
+	void Shader::submit()
+	{
+		std::set<std::string> vIncluded, fIncluded;
+		std::string vShaderStr = injectDefines(preprocess(m_VertexPath, vIncluded), m_Defines);
+		std::string fShaderStr = injectDefines(preprocess(m_FragmentPath, fIncluded), m_Defines);
+
+		m_Files = vIncluded;
+		m_Files.insert(fIncluded.begin(), fIncluded.end());
+		for (const std::string& file : m_Files)
+			s_Watcher.addFile(file);
+
+		// preprocessed sources include the defines, so every variant gets its own binary
+		m_CacheKey = getCacheKey(vShaderStr, fShaderStr);
+		if (!loadBinary(m_CacheKey))
+			compile(vShaderStr, fShaderStr);
+		m_Pending = true;
+	}
+
+	void Shader::enableHotReload()
+	{
+		s_Watcher.start();
+	}
+
+	void Shader::reloadChanged()
+	{
+		std::vector<std::string> changed = s_Watcher.takeChanged();
+		if (changed.empty())
+			return;
+
+		for (auto& variant : s_Variants)
 		{
-			LOGL::error("ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: ");
+			Shader& shader = *variant.second;
+			for (const std::string& file : changed)
+			{
+				if (shader.m_Files.count(file))
+				{
+					shader.reload();
+					break;
+				}
+			}
 		}
+	}
+
+	bool Shader::reload()
+	{
+		if (m_Pending)
+			finish();
+
+		GLuint oldID = ID;
+		bool oldValid = m_Valid;
+		std::unordered_map<std::string, GLint> oldUniforms = m_Uniforms;
+
+		submit();
+		finish();
+		if (!m_Valid)
+		{
+			// the old program keeps running until the source is fixed
+			LOGL::error("bool Shader::reload() -> %s, %s failed, keeping the old program", m_VertexPath.c_str(), m_FragmentPath.c_str());
+			GLState.deleteProgram(ID);
+			ID = oldID;
+			m_Uniforms = oldUniforms;
+			m_Valid = oldValid;
+			return false;
+		}
+
+		copyUniforms(oldID);
+		GLState.deleteProgram(oldID);
+		m_Revision++;
+		LOGL::log("bool Shader::reload() -> reloaded %s, %s", m_VertexPath.c_str(), m_FragmentPath.c_str());
+		return true;
+	}
+
+	unsigned int Shader::getRevision() const
+	{
+		return m_Revision;
+	}
+
+	void Shader::copyUniforms(GLuint from)
+	{
+		// values are read from the old program and written by name where the type still matches
+		std::unordered_map<std::string, UniformValue> values;
+
+		GLint count = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(from, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::string name(maxLength, '\0');
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(from, i, maxLength, &length, &size, &type, &name[0]);
+
+			std::string uniform = name.substr(0, length);
+			bool isArray = uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0;
+			std::string base = isArray ? uniform.substr(0, uniform.size() - 3) : uniform;
+			for (GLint j = 0; j < size; j++)
+			{
+				std::string element = isArray ? base + "[" + std::to_string(j) + "]" : uniform;
+				UniformValue value;
+				value.type = type;
+				value.location = glGetUniformLocation(from, element.c_str());
+				if (value.location < 0) // uniform block members
+					continue;
+
+				switch (type)
+				{
+				case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+				case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+					glGetUniformfv(from, value.location, (GLfloat*)value.values);
+					break;
+				case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+					glGetUniformuiv(from, value.location, (GLuint*)value.values);
+					break;
+				default: // ints, bools and samplers
+					glGetUniformiv(from, value.location, value.values);
+					break;
+				}
+				values[element] = value;
+			}
+		}
+
+		GLuint current = GLState.getProgram();
+		GLState.useProgram(ID);
+
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		name.assign(maxLength, '\0');
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+
+			std::string uniform = name.substr(0, length);
+			bool isArray = uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0;
+			std::string base = isArray ? uniform.substr(0, uniform.size() - 3) : uniform;
+			for (GLint j = 0; j < size; j++)
+			{
+				std::string element = isArray ? base + "[" + std::to_string(j) + "]" : uniform;
+				auto it = values.find(element);
+				GLint location = getLocation(element);
+				if (it == values.end() || it->second.type != type || location < 0)
+					continue;
+
+				const GLint* v = it->second.values;
+				switch (type)
+				{
+				case GL_FLOAT: glUniform1fv(location, 1, (const GLfloat*)v); break;
+				case GL_FLOAT_VEC2: glUniform2fv(location, 1, (const GLfloat*)v); break;
+				case GL_FLOAT_VEC3: glUniform3fv(location, 1, (const GLfloat*)v); break;
+				case GL_FLOAT_VEC4: glUniform4fv(location, 1, (const GLfloat*)v); break;
+				case GL_FLOAT_MAT2: glUniformMatrix2fv(location, 1, GL_FALSE, (const GLfloat*)v); break;
+				case GL_FLOAT_MAT3: glUniformMatrix3fv(location, 1, GL_FALSE, (const GLfloat*)v); break;
+				case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, (const GLfloat*)v); break;
+				case GL_UNSIGNED_INT: glUniform1uiv(location, 1, (const GLuint*)v); break;
+				case GL_UNSIGNED_INT_VEC2: glUniform2uiv(location, 1, (const GLuint*)v); break;
+				case GL_UNSIGNED_INT_VEC3: glUniform3uiv(location, 1, (const GLuint*)v); break;
+				case GL_UNSIGNED_INT_VEC4: glUniform4uiv(location, 1, (const GLuint*)v); break;
+				case GL_INT_VEC2: case GL_BOOL_VEC2: glUniform2iv(location, 1, v); break;
+				case GL_INT_VEC3: case GL_BOOL_VEC3: glUniform3iv(location, 1, v); break;
+				case GL_INT_VEC4: case GL_BOOL_VEC4: glUniform4iv(location, 1, v); break;
+				default: glUniform1iv(location, 1, v); break;
+				}
+			}
+		}
+
+		// the caller's program stays bound, the reloaded one replaces its old ID
+		GLState.useProgram(current == from ? ID : current);
+	}
+
+	bool Shader::isReady()
+	{
+		if (!m_Pending)
+			return true;
+
+		if (GLExt.KHR_parallel_shader_compile && m_Vertex)
+		{
+			GLint done = GL_FALSE;
+			glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+				return false;
+		}
+		finish();
+		return true;
+	}
+
+	bool Shader::isValid() const
+	{
+		return m_Valid;
+	}
+
+	void Shader::finish()
+	{
+		m_Pending = false;
+
+		// m_Vertex is 0 when the program was loaded from the binary cache
+		if (m_Vertex)
+		{
+			bool compiled = checkCompileErrors(m_Vertex, "VERTEX");
+			compiled = checkCompileErrors(m_Fragment, "FRAGMENT") && compiled;
+			m_Valid = compiled && checkCompileErrors(ID, "PROGRAM");
+
+			glDeleteShader(m_Vertex);
+			glDeleteShader(m_Fragment);
+			m_Vertex = m_Fragment = 0;
+
+			if (m_Valid)
+				saveBinary(m_CacheKey);
+		}
+		else
+			m_Valid = true;
+
+		reflectUniforms();
+
+		// every program that declares the shared block reads it from the same binding
+		if (glGetUniformBlockIndex(ID, "FrameConstants") != GL_INVALID_INDEX)
+			bindUniformBlock("FrameConstants", FRAME_CONSTANTS_BINDING);
+		if (glGetUniformBlockIndex(ID, "Materials") != GL_INVALID_INDEX)
+			bindUniformBlock("Materials", MATERIAL_BINDING);
+	}
+
+	void Shader::compile(const std::string& vShaderStr, const std::string& fShaderStr)
+	{
 		const char* vShaderCode = vShaderStr.c_str();
 		const char* fShaderCode = fShaderStr.c_str();
-		// 2. compile shaders
-		unsigned int vertex, fragment;
+		// 2. compile shaders, errors are checked in finish()
 		// vertex shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
+		m_Vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(m_Vertex, 1, &vShaderCode, NULL);
+		glCompileShader(m_Vertex);
 		// fragment Shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
+		m_Fragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(m_Fragment, 1, &fShaderCode, NULL);
+		glCompileShader(m_Fragment);
 		// shader Program
 		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
+		glAttachShader(ID, m_Vertex);
+		glAttachShader(ID, m_Fragment);
+		if (GLExt.ARB_get_program_binary)
+			GLExt.ProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
+	}
+
+	std::string Shader::getCacheKey(const std::string& vShaderStr, const std::string& fShaderStr)
+	{
+		// FNV-1a over the sources and the driver, a new driver gets a new key
+		uint64_t hash = 14695981039346656037ull;
+		auto append = [&hash](const char* str) {
+			for (const char* c = str ? str : ""; ; c++)
+			{
+				hash ^= (unsigned char)*c;
+				hash *= 1099511628211ull;
+				if (!*c)
+					break;
+			}
+		};
+		append(vShaderStr.c_str());
+		append(fShaderStr.c_str());
+		append((const char*)glGetString(GL_VENDOR));
+		append((const char*)glGetString(GL_RENDERER));
+		append((const char*)glGetString(GL_VERSION));
+
+		char key[17];
+		snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+		return key;
+	}
+
+	bool Shader::loadBinary(const std::string& cacheKey)
+	{
+		if (!GLExt.ARB_get_program_binary)
+			return false;
+
+		std::ifstream file(SHADER_CACHE_DIR + cacheKey + ".bin", std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		file.seekg(0, std::ios::end);
+		std::streamoff fileSize = file.tellg();
+		file.seekg(0, std::ios::beg);
+
+		ProgramBinaryHeader header;
+		if (!file.read((char*)&header, sizeof(header)) || header.magic != PROGRAM_BINARY_MAGIC)
+			return false;
+		// a truncated or corrupt file must not size the allocation or reach the driver
+		if (header.length == 0 || header.length > INT32_MAX || (std::streamoff)header.length > fileSize - (std::streamoff)sizeof(header))
+		{
+			LOGL::warning("bool Shader::loadBinary(const std::string& cacheKey) -> %s has a bad length, compiling from source", cacheKey.c_str());
+			return false;
+		}
+		if (std::find(GLExt.ProgramBinaryFormats.begin(), GLExt.ProgramBinaryFormats.end(), header.format) == GLExt.ProgramBinaryFormats.end())
+		{
+			LOGL::warning("bool Shader::loadBinary(const std::string& cacheKey) -> %s has an unsupported format, compiling from source", cacheKey.c_str());
+			return false;
+		}
+		std::vector<char> binary(header.length);
+		if (!file.read(binary.data(), header.length))
+			return false;
+
+		ID = glCreateProgram();
+		GLExt.ProgramBinary(ID, header.format, binary.data(), (GLsizei)header.length);
+
+		int success;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			LOGL::warning("bool Shader::loadBinary(const std::string& cacheKey) -> %s rejected by driver, compiling from source", cacheKey.c_str());
+			GLState.deleteProgram(ID);
+			ID = 0;
+			return false;
+		}
+		return true;
+	}
+
+	void Shader::saveBinary(const std::string& cacheKey)
+	{
+		if (!GLExt.ARB_get_program_binary)
+			return;
+
+		int success;
+		GLint length = 0;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (!success || length <= 0)
+			return;
+
+		ProgramBinaryHeader header;
+		header.magic = PROGRAM_BINARY_MAGIC;
+		header.length = (uint32_t)length;
+		std::vector<char> binary(length);
+		GLExt.GetProgramBinary(ID, length, NULL, &header.format, binary.data());
+
+#ifdef _WIN32
+		_mkdir(SHADER_CACHE_DIR);
+#else
+		mkdir(SHADER_CACHE_DIR, 0755);
+#endif
+		std::ofstream file(SHADER_CACHE_DIR + cacheKey + ".bin", std::ios::binary);
+		if (!file.is_open())
+		{
+			LOGL::warning("void Shader::saveBinary(const std::string& cacheKey) -> can't write %s", cacheKey.c_str());
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), length);
+	}
+
+	void Shader::reflectUniforms()
+	{
+		m_Uniforms.clear();
+
+		GLint count = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::string name(maxLength, '\0');
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+
+			std::string uniform = name.substr(0, length);
+			GLint location = glGetUniformLocation(ID, uniform.c_str());
+			if (location < 0) // uniform block members
+				continue;
+
+			m_Uniforms[uniform] = location;
+
+			// arrays of basic types are reported once as "name[0]"; GL doesn't promise
+			// consecutive locations for the elements, each one is queried
+			if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+			{
+				std::string base = uniform.substr(0, uniform.size() - 3);
+				m_Uniforms[base] = location;
+				for (GLint j = 1; j < size; j++)
+				{
+					std::string element = base + "[" + std::to_string(j) + "]";
+					GLint elementLocation = glGetUniformLocation(ID, element.c_str());
+					if (elementLocation >= 0)
+						m_Uniforms[element] = elementLocation;
+				}
+			}
+		}
+	}
 
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+	GLint Shader::getLocation(const std::string& name) const
+	{
+		auto it = m_Uniforms.find(name);
+		if (it == m_Uniforms.end())
+			return -1;
+		return it->second;
 	}
 
 	void Shader::use()
 	{
-		glUseProgram(ID);
+		if (m_Pending)
+			finish();
+		GLState.useProgram(ID);
+	}
+
+	void Shader::bindUniformBlock(const std::string& name, GLuint binding) const
+	{
+		GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+		if (index == GL_INVALID_INDEX)
+		{
+			LOGL::warning("void Shader::bindUniformBlock(const std::string& name, GLuint binding) -> no block %s", name.c_str());
+			return;
+		}
+		glUniformBlockBinding(ID, index, binding);
 	}
 
 	void Shader::setBool(const std::string& name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(getLocation(name), (int)value);
 	}
 
 	void Shader::setInt(const std::string& name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(getLocation(name), value);
 	}
 
 	void Shader::setFloat(const std::string& name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(getLocation(name), value);
 	}
 
 	void Shader::setMat4(const std::string& name, const glm::mat4& value) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+		glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+	void Shader::setVec2(const std::string& name, const glm::vec2& value) const
+	{
+		glUniform2fv(getLocation(name), 1, &value[0]);
 	}
 
 	void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform3fv(getLocation(name), 1, &value[0]);
 	}
 
 	void Shader::setVec3(const std::string& name, float x, float y, float z) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(glm::vec3(x, y, z)));
+		glUniform3fv(getLocation(name), 1, glm::value_ptr(glm::vec3(x, y, z)));
+	}
+
+	void Shader::setBool(GLint location, bool value) const
+	{
+		glUniform1i(location, (int)value);
+	}
+
+	void Shader::setInt(GLint location, int value) const
+	{
+		glUniform1i(location, value);
+	}
+
+	void Shader::setFloat(GLint location, float value) const
+	{
+		glUniform1f(location, value);
+	}
+
+	void Shader::setMat4(GLint location, const glm::mat4& value) const
+	{
+		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+	void Shader::setVec2(GLint location, const glm::vec2& value) const
+	{
+		glUniform2fv(location, 1, &value[0]);
+	}
+
+	void Shader::setVec3(GLint location, const glm::vec3& value) const
+	{
+		glUniform3fv(location, 1, &value[0]);
+	}
+
+	bool benchmarkUniforms(int calls)
+	{
+		if (calls <= 0)
+			return false;
+
+		Shader shader("shaders/uniform_benchvs.glsl", "shaders/uniform_benchfs.glsl");
+		if (!shader.isValid())
+			return false;
+		shader.use();
+		GLint modelLocation = shader.getLocation("model");
+		GLint colorLocation = shader.getLocation("color");
+
+		const char* paths[] = { "glGetUniformLocation", "name lookup", "cached location" };
+		for (int path = 0; path < 3; path++)
+		{
+			double seconds = 0.0;
+			// the first pass warms up the driver, it isn't counted
+			for (int pass = 0; pass < 2; pass++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < calls; i++)
+				{
+					// values change every call so the driver can't skip them
+					glm::mat4 model(1.0f);
+					model[3][0] = (float)i;
+					glm::vec3 color((float)(i & 255) / 255.0f);
+					if (path == 0)
+					{
+						glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+						glUniform3fv(glGetUniformLocation(shader.ID, "color"), 1, &color[0]);
+					}
+					else if (path == 1)
+					{
+						shader.setMat4("model", model);
+						shader.setVec3("color", color);
+					}
+					else
+					{
+						shader.setMat4(modelLocation, model);
+						shader.setVec3(colorLocation, color);
+					}
+				}
+				glFinish();
+				seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+			LOGL::log("bool benchmarkUniforms(int calls) -> %-20s %8.1f ns/call", paths[path], seconds * 1e9 / (2.0 * calls));
+		}
+
+		GLState.useProgram(0);
+		GLState.deleteProgram(shader.ID);
+		return true;
 	}
 
-}
\ No newline at end of file
+	bool benchmarkStartup()
+	{
+		// copied first, constructing programs doesn't touch the variants
+		std::vector<std::shared_ptr<Shader>> variants;
+		for (auto& variant : s_Variants)
+		{
+			// an async variant finished later would write its binary into the cold pass
+			if (variant.second->m_Pending)
+				variant.second->finish();
+			variants.push_back(variant.second);
+		}
+		if (variants.empty())
+			return false;
+
+		// only our cache is cleared, the driver may keep its own (MESA_SHADER_CACHE_DISABLE=true
+		// on Mesa) and make the cold pass look warm
+		for (auto& variant : variants)
+			std::remove((SHADER_CACHE_DIR + variant->m_CacheKey + ".bin").c_str());
+
+		bool passed = true;
+		const char* passes[] = { "cold", "warm" };
+		for (int pass = 0; pass < 2; pass++)
+		{
+			double total = 0.0;
+			for (auto& variant : variants)
+			{
+				auto start = std::chrono::steady_clock::now();
+				Shader shader(variant->m_VertexPath.c_str(), variant->m_FragmentPath.c_str(), variant->m_Defines);
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				total += seconds;
+				passed = passed && shader.isValid();
+				LOGL::log("bool benchmarkStartup() -> %s %8.2f ms  %s, %s", passes[pass], seconds * 1000.0,
+					variant->m_VertexPath.c_str(), variant->m_FragmentPath.c_str());
+				GLState.deleteProgram(shader.ID);
+			}
+			LOGL::log("bool benchmarkStartup() -> %s %8.2f ms for %d programs", passes[pass], total * 1000.0, (int)variants.size());
+		}
+		return passed;
+	}
+}
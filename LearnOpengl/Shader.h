@@ -4,20 +4,52 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <unordered_map>
+#include <map>
+#include <set>
+#include <memory>
 #include "logger.h"
 #include "glm/glm.hpp"
 
 namespace LOGL
 {
+	// name -> value, injected as "#define name value" after #version
+	typedef std::map<std::string, std::string> ShaderDefines;
+
 	class Shader
 	{
 	public:
 		GLuint ID;
 
-		Shader(const char* vertexPath, const char* fragmentPath);
+		// async only submits compile and link, the program can't be used before isReady()
+		Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines(), bool async = false);
+
+		// one program per (vertexPath, fragmentPath, defines), shared by every caller asking for it
+		static std::shared_ptr<Shader> getVariant(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines = ShaderDefines(), bool async = false);
+
+		// polls GL_COMPLETION_STATUS_KHR, finishes the program once the driver is done;
+		// without GL_KHR_parallel_shader_compile it waits for the driver
+		bool isReady();
+
+		// false if compile or link failed
+		bool isValid() const;
+
+		// starts watching the source files of every shader, including #include'd ones
+		static void enableHotReload();
+		// recompiles variants whose files changed, call on the GL thread once per frame
+		static void reloadChanged();
+		// relinks from disk, uniform values are kept; on failure the old program stays
+		bool reload();
+		// incremented on every reload, uniform locations cached before are stale
+		unsigned int getRevision() const;
 
 		void use();
 
+		// returns location resolved after link, -1 if uniform is not active
+		GLint getLocation(const std::string& name) const;
+
+		void bindUniformBlock(const std::string& name, GLuint binding) const;
+
 		void setBool(const std::string& name, bool value) const;
 
 		void setInt(const std::string& name, int value) const;
@@ -26,12 +58,65 @@ namespace LOGL
 
 		void setMat4(const std::string& name, const glm::mat4& value) const;
 
+		void setVec2(const std::string& name, const glm::vec2& value) const;
+
 		void setVec3(const std::string& name, const glm::vec3& value) const;
 
 		void setVec3(const std::string& name, float x, float y, float z) const;
+
+		void setBool(GLint location, bool value) const;
+
+		void setInt(GLint location, int value) const;
+
+		void setFloat(GLint location, float value) const;
+
+		void setMat4(GLint location, const glm::mat4& value) const;
+
+		void setVec2(GLint location, const glm::vec2& value) const;
+
+		void setVec3(GLint location, const glm::vec3& value) const;
 	private:
+		std::unordered_map<std::string, GLint> m_Uniforms;
+
+		std::string m_VertexPath;
+		std::string m_FragmentPath;
+		ShaderDefines m_Defines;
+		// every file read for this program, includes too
+		std::set<std::string> m_Files;
+		unsigned int m_Revision = 0;
+
+		// set between compile() and finish()
+		bool m_Pending = false;
+		bool m_Valid = false;
+		GLuint m_Vertex = 0;
+		GLuint m_Fragment = 0;
+		std::string m_CacheKey;
+
 		std::string readFile(const char* filePath);
-		void checkCompileErrors(GLuint shader, const std::string& type);
+		// resolves #include "file" relative to the including file, every file is included once
+		std::string preprocess(const std::string& filePath, std::set<std::string>& included);
+		std::string injectDefines(const std::string& source, const ShaderDefines& defines);
+		void submit();
+		void compile(const std::string& vShaderStr, const std::string& fShaderStr);
+		void finish();
+		void copyUniforms(GLuint from);
+		bool checkCompileErrors(GLuint shader, const std::string& type);
+
+		// program binaries are cached on disk keyed by source and driver
+		std::string getCacheKey(const std::string& vShaderStr, const std::string& fShaderStr);
+		bool loadBinary(const std::string& cacheKey);
+		void saveBinary(const std::string& cacheKey);
+		void reflectUniforms();
+
+		friend bool benchmarkStartup();
 	};
+
+	// times calls setMat4 + setVec3 pairs through glGetUniformLocation, the name lookup
+	// and cached locations, logs ns per call
+	bool benchmarkUniforms(int calls);
+
+	// deletes the cached binary of every getVariant() program, times creating all of them
+	// from source and again from the binaries, logs ms per program
+	bool benchmarkStartup();
 }
 
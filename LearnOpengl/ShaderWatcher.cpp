@@ -0,0 +1,168 @@
+#include "ShaderWatcher.h"
+#include "logger.h"
+#include <chrono>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define SHADER_WATCHER_POLL_MS 250
+
+namespace LOGL
+{
+	static std::string directoryOf(const std::string& path)
+	{
+		return path.substr(0, path.find_last_of("/\\") + 1);
+	}
+
+	static long long modificationTime(const std::string& path)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			return -1;
+		return (long long)info.st_mtime;
+	}
+
+	ShaderWatcher::ShaderWatcher()
+		: m_HasChanged(false), m_Running(false)
+	{
+	}
+
+	ShaderWatcher::~ShaderWatcher()
+	{
+		stop();
+	}
+
+	void ShaderWatcher::start()
+	{
+		if (m_Running)
+			return;
+
+#ifdef __linux__
+		m_Fd = inotify_init1(IN_NONBLOCK);
+		if (m_Fd < 0)
+		{
+			LOGL::error("void ShaderWatcher::start() -> inotify_init1 failed");
+			return;
+		}
+#endif
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (const std::string& file : m_Files)
+			{
+				watchDirectory(directoryOf(file));
+				m_Times[file] = modificationTime(file);
+			}
+		}
+
+		m_Running = true;
+		m_Thread = std::thread(&ShaderWatcher::run, this);
+	}
+
+	void ShaderWatcher::stop()
+	{
+		if (!m_Running)
+			return;
+
+		m_Running = false;
+		m_Thread.join();
+#ifdef __linux__
+		close(m_Fd);
+		m_Fd = -1;
+		m_Directories.clear();
+#endif
+	}
+
+	void ShaderWatcher::addFile(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Files.insert(path).second)
+			return;
+
+		if (m_Running)
+		{
+			watchDirectory(directoryOf(path));
+			m_Times[path] = modificationTime(path);
+		}
+	}
+
+	std::vector<std::string> ShaderWatcher::takeChanged()
+	{
+		if (!m_HasChanged)
+			return std::vector<std::string>();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::vector<std::string> changed(m_Changed.begin(), m_Changed.end());
+		m_Changed.clear();
+		m_HasChanged = false;
+		return changed;
+	}
+
+	void ShaderWatcher::watchDirectory(const std::string& dir)
+	{
+#ifdef __linux__
+		for (const auto& watched : m_Directories)
+			if (watched.second == dir)
+				return;
+
+		// editors often save by writing a new file and renaming it, so the directory is watched
+		int wd = inotify_add_watch(m_Fd, dir.empty() ? "." : dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0)
+		{
+			LOGL::warning("void ShaderWatcher::watchDirectory(const std::string& dir) -> can't watch %s", dir.c_str());
+			return;
+		}
+		m_Directories[wd] = dir;
+#endif
+	}
+
+	void ShaderWatcher::run()
+	{
+		while (m_Running)
+		{
+#ifdef __linux__
+			pollfd fd = { m_Fd, POLLIN, 0 };
+			if (poll(&fd, 1, SHADER_WATCHER_POLL_MS) <= 0)
+				continue;
+
+			alignas(inotify_event) char buffer[4096];
+			ssize_t length;
+			while ((length = read(m_Fd, buffer, sizeof(buffer))) > 0)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len)
+				{
+					const inotify_event* event = (const inotify_event*)ptr;
+					auto dir = m_Directories.find(event->wd);
+					if (dir == m_Directories.end() || !event->len)
+						continue;
+
+					std::string path = dir->second + event->name;
+					if (m_Files.count(path))
+					{
+						m_Changed.insert(path);
+						m_HasChanged = true;
+					}
+				}
+			}
+#else
+			std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCHER_POLL_MS));
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (const std::string& file : m_Files)
+			{
+				long long time = modificationTime(file);
+				long long& last = m_Times[file];
+				if (time != last)
+				{
+					last = time;
+					m_Changed.insert(file);
+					m_HasChanged = true;
+				}
+			}
+#endif
+		}
+	}
+}
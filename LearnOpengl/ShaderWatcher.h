@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+namespace LOGL
+{
+	// flags shader source files changed on disk, inotify on linux and
+	// modification time polling elsewhere; the GL thread collects them with takeChanged()
+	class ShaderWatcher
+	{
+	public:
+		ShaderWatcher();
+		~ShaderWatcher();
+
+		void start();
+		void stop();
+
+		// paths as passed to Shader, files can be added before or after start()
+		void addFile(const std::string& path);
+
+		// files changed since the last call
+		std::vector<std::string> takeChanged();
+	private:
+		void run();
+		void watchDirectory(const std::string& dir);
+
+		std::mutex m_Mutex;
+		std::set<std::string> m_Files;
+		std::set<std::string> m_Changed;
+		std::atomic<bool> m_HasChanged;
+
+		std::thread m_Thread;
+		std::atomic<bool> m_Running;
+
+		// inotify watch descriptor -> directory prefix of the watched files
+		int m_Fd = -1;
+		std::map<int, std::string> m_Directories;
+		// mtime of every file when polling
+		std::map<std::string, long long> m_Times;
+	};
+}
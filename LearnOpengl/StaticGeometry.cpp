@@ -0,0 +1,382 @@
+#include "StaticGeometry.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "logger.h"
+#include <chrono>
+
+namespace LOGL
+{
+	StaticGeometry::StaticGeometry()
+	{
+	}
+
+	void StaticGeometry::init(VertexLayout layout)
+	{
+		m_Format = VertexFormat::get(layout);
+		m_VertexCapacity = STATIC_GEOMETRY_VERTEX_CAPACITY;
+		m_IndexCapacity = STATIC_GEOMETRY_INDEX_CAPACITY;
+
+		GLuint buffers[4];
+		glGenBuffers(4, buffers);
+		m_VertexBuffer = buffers[0];
+		m_IndexBuffer = buffers[1];
+		m_CommandBuffer = buffers[2];
+		m_VisibleBuffer = buffers[3];
+		// GL_COPY_WRITE_BUFFER leaves the element buffer of whatever VAO is bound alone
+		GLState.bindBuffer(GL_COPY_WRITE_BUFFER, m_VertexBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_VertexCapacity * m_Format.stride, NULL, GL_STATIC_DRAW);
+		GLState.bindBuffer(GL_COPY_WRITE_BUFFER, m_IndexBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_IndexCapacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+
+		m_InstanceBuffer.init();
+		glGenVertexArrays(1, &m_MultiDrawVAO);
+		glGenVertexArrays(1, &m_DirectVAO);
+		setupVertexArrays();
+		m_InstanceBuffer.attach(m_MultiDrawVAO);
+	}
+
+	void StaticGeometry::setupVertexArrays()
+	{
+		GLuint vaos[] = { m_MultiDrawVAO, m_DirectVAO };
+		for (GLuint vao : vaos)
+		{
+			GLState.bindVertexArray(vao);
+			GLState.bindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer);
+			m_Format.apply();
+			GLState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
+		}
+		GLState.bindVertexArray(0);
+		GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	GLuint StaticGeometry::grow(GLuint buffer, size_t used, size_t capacity)
+	{
+		GLuint grown = 0;
+		glGenBuffers(1, &grown);
+		GLState.bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+		glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+		if (used)
+		{
+			GLState.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+		}
+		GLState.deleteBuffers(1, &buffer);
+		return grown;
+	}
+
+	void StaticGeometry::reserve(size_t vertexCount, size_t indexCount)
+	{
+		bool grown = false;
+		if (m_VertexCount + vertexCount > m_VertexCapacity)
+		{
+			while (m_VertexCount + vertexCount > m_VertexCapacity)
+				m_VertexCapacity *= 2;
+			m_VertexBuffer = grow(m_VertexBuffer, m_VertexCount * m_Format.stride, m_VertexCapacity * m_Format.stride);
+			grown = true;
+		}
+		if (m_IndexCount + indexCount > m_IndexCapacity)
+		{
+			while (m_IndexCount + indexCount > m_IndexCapacity)
+				m_IndexCapacity *= 2;
+			m_IndexBuffer = grow(m_IndexBuffer, m_IndexCount * sizeof(uint32_t), m_IndexCapacity * sizeof(uint32_t));
+			grown = true;
+		}
+		// the attribute pointers still name the deleted buffers
+		if (grown)
+			setupVertexArrays();
+	}
+
+	GLint StaticGeometry::addMesh(const MeshData& data)
+	{
+		if (!m_VertexBuffer)
+		{
+			LOGL::error("GLint StaticGeometry::addMesh(const MeshData& data) -> init() wasn't called");
+			return -1;
+		}
+		if (data.format.stride != m_Format.stride)
+		{
+			LOGL::error("GLint StaticGeometry::addMesh(const MeshData& data) -> vertex stride %d doesn't match the layout of the shared buffer (%d)",
+				(int)data.format.stride, (int)m_Format.stride);
+			return -1;
+		}
+		reserve(data.vertexCount, data.indexCount);
+
+		StaticMesh mesh;
+		mesh.baseVertex = (GLint)m_VertexCount;
+		mesh.firstIndex = (GLuint)m_IndexCount;
+		mesh.indexCount = data.lods.empty() ? (GLuint)data.indexCount : data.lods[0].indexCount;
+		mesh.boundsMin = data.boundsMin;
+		mesh.boundsMax = data.boundsMax;
+		mesh.lods = data.lods;
+		for (MeshLod& lod : mesh.lods)
+			lod.firstIndex += mesh.firstIndex;
+		if (!mesh.lods.empty())
+			mesh.firstIndex = mesh.lods[0].firstIndex;
+
+		GLState.bindBuffer(GL_COPY_WRITE_BUFFER, m_VertexBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, m_VertexCount * m_Format.stride, data.vertexCount * m_Format.stride, data.vertices);
+
+		GLState.bindBuffer(GL_COPY_WRITE_BUFFER, m_IndexBuffer);
+		if (data.indexType == GL_UNSIGNED_SHORT)
+		{
+			const uint16_t* indices = (const uint16_t*)data.indices;
+			std::vector<uint32_t> widened(indices, indices + data.indexCount);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, m_IndexCount * sizeof(uint32_t), widened.size() * sizeof(uint32_t), widened.data());
+		}
+		else
+			glBufferSubData(GL_COPY_WRITE_BUFFER, m_IndexCount * sizeof(uint32_t), data.indexCount * sizeof(uint32_t), data.indices);
+
+		m_VertexCount += data.vertexCount;
+		m_IndexCount += data.indexCount;
+		m_Meshes.push_back(mesh);
+		return (GLint)m_Meshes.size() - 1;
+	}
+
+	size_t StaticGeometry::addDraw(GLint mesh, const glm::mat4& model, GLint material)
+	{
+		const StaticMesh& staticMesh = m_Meshes[mesh];
+		DrawElementsIndirectCommand command;
+		command.count = staticMesh.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = staticMesh.firstIndex;
+		command.baseVertex = staticMesh.baseVertex;
+		command.baseInstance = (GLuint)m_Commands.size();
+		m_Commands.push_back(command);
+		m_Instances.push_back(makeInstance(model, material));
+		m_Bounds.add(model, staticMesh.boundsMin, staticMesh.boundsMax);
+		m_Dirty = true;
+		return m_Commands.size() - 1;
+	}
+
+	void StaticGeometry::clearDraws()
+	{
+		m_Commands.clear();
+		m_Instances.clear();
+		m_Bounds.clear();
+		m_Dirty = true;
+	}
+
+	void StaticGeometry::clear()
+	{
+		GLuint buffers[] = { m_VertexBuffer, m_IndexBuffer, m_CommandBuffer, m_VisibleBuffer, m_InstanceBuffer.getBuffer() };
+		GLState.deleteBuffers(5, buffers);
+		GLuint vaos[] = { m_MultiDrawVAO, m_DirectVAO };
+		GLState.deleteVertexArrays(2, vaos);
+		m_VertexBuffer = m_IndexBuffer = m_CommandBuffer = m_VisibleBuffer = 0;
+		m_MultiDrawVAO = m_DirectVAO = 0;
+		m_InstanceBuffer = InstanceBuffer();
+		m_VertexCount = m_VertexCapacity = 0;
+		m_IndexCount = m_IndexCapacity = 0;
+		m_Meshes.clear();
+		m_Commands.clear();
+		m_Instances.clear();
+		m_Bounds.clear();
+		m_Dirty = false;
+		m_Stats = StaticGeometryStats();
+	}
+
+	void StaticGeometry::upload()
+	{
+		m_InstanceBuffer.upload(m_Instances.data(), m_Instances.size());
+		if (isMultiDrawSupported())
+		{
+			GLState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, m_Commands.size() * sizeof(DrawElementsIndirectCommand), m_Commands.data(), GL_STATIC_DRAW);
+		}
+		m_Dirty = false;
+	}
+
+	void StaticGeometry::draw()
+	{
+		m_Stats.draws = m_Commands.size();
+		m_Stats.drawCalls = 0;
+		m_Stats.vertexCount = m_VertexCount;
+		m_Stats.indexCount = m_IndexCount;
+		if (m_Commands.empty())
+			return;
+		if (m_Dirty)
+			upload();
+
+		if (m_MultiDraw && isMultiDrawSupported())
+		{
+			GLState.bindVertexArray(m_MultiDrawVAO);
+			GLState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+			GLExt.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)m_Commands.size(), 0);
+			m_Stats.drawCalls = 1;
+			return;
+		}
+
+		// the instance attributes are constant values in this VAO
+		GLState.bindVertexArray(m_DirectVAO);
+		for (size_t i = 0; i < m_Commands.size(); i++)
+		{
+			const DrawElementsIndirectCommand& command = m_Commands[i];
+			setInstanceAttribs(m_Instances[i]);
+			glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
+		}
+		m_Stats.drawCalls = m_Commands.size();
+	}
+
+	void StaticGeometry::draw(const std::vector<uint32_t>& visible)
+	{
+		m_Stats.draws = visible.size();
+		m_Stats.drawCalls = 0;
+		m_Stats.vertexCount = m_VertexCount;
+		m_Stats.indexCount = m_IndexCount;
+		if (visible.empty())
+			return;
+		if (m_Dirty)
+			upload();
+
+		if (m_MultiDraw && isMultiDrawSupported())
+		{
+			// baseInstance still points at the draw's own InstanceData, only the commands move
+			m_VisibleCommands.resize(visible.size());
+			for (size_t i = 0; i < visible.size(); i++)
+				m_VisibleCommands[i] = m_Commands[visible[i]];
+			GLState.bindVertexArray(m_MultiDrawVAO);
+			GLState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_VisibleBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, m_VisibleCommands.size() * sizeof(DrawElementsIndirectCommand), m_VisibleCommands.data(), GL_STREAM_DRAW);
+			GLExt.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)m_VisibleCommands.size(), 0);
+			m_Stats.drawCalls = 1;
+			return;
+		}
+
+		GLState.bindVertexArray(m_DirectVAO);
+		for (uint32_t index : visible)
+		{
+			const DrawElementsIndirectCommand& command = m_Commands[index];
+			setInstanceAttribs(m_Instances[index]);
+			glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(uint32_t)), command.baseVertex);
+		}
+		m_Stats.drawCalls = visible.size();
+	}
+
+	void StaticGeometry::setMultiDraw(bool enabled)
+	{
+		m_MultiDraw = enabled;
+	}
+
+	bool StaticGeometry::getMultiDraw() const
+	{
+		return m_MultiDraw;
+	}
+
+	bool StaticGeometry::isMultiDrawSupported()
+	{
+		return GLExt.ARB_multi_draw_indirect;
+	}
+
+	const StaticMesh& StaticGeometry::getMesh(GLint mesh) const
+	{
+		return m_Meshes[mesh];
+	}
+
+	const BoundingBoxes& StaticGeometry::getBounds() const
+	{
+		return m_Bounds;
+	}
+
+	size_t StaticGeometry::getMeshCount() const
+	{
+		return m_Meshes.size();
+	}
+
+	size_t StaticGeometry::getDrawCount() const
+	{
+		return m_Commands.size();
+	}
+
+	const StaticGeometryStats& StaticGeometry::getStats() const
+	{
+		return m_Stats;
+	}
+
+	bool benchmarkStaticGeometry(int count, const std::function<MeshData(MeshBuilder& builder, int index)>& createMesh, const std::function<InstanceData(int index)>& createInstance)
+	{
+		if (count <= 0)
+			return false;
+
+		// the current path: a VAO, vertex and index buffer per mesh and one draw each
+		std::vector<Mesh> meshes;
+		std::vector<InstanceData> instances;
+		MeshBuilder builder;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			meshes.push_back(uploadMesh(createMesh(builder, i)));
+			instances.push_back(createInstance(i));
+		}
+		glFinish();
+		double separateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		StaticGeometry geometry;
+		geometry.init();
+		for (int i = 0; i < count; i++)
+		{
+			GLint mesh = geometry.addMesh(createMesh(builder, i));
+			if (mesh >= 0)
+				geometry.addDraw(mesh, instances[i].model, instances[i].material);
+		}
+		glFinish();
+		double sharedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		LOGL::log("bool benchmarkStaticGeometry(int count, const std::function<MeshData(MeshBuilder& builder, int index)>& createMesh, const std::function<InstanceData(int index)>& createInstance) -> %d unique meshes: separate buffers built in %.0f ms, shared buffers in %.0f ms",
+			count, separateSeconds * 1000.0, sharedSeconds * 1000.0);
+
+		GLuint timeQuery = 0;
+		glGenQueries(1, &timeQuery);
+
+		const char* paths[] = { "separate VAOs", "shared buffers, a draw each", "multi draw indirect" };
+		for (int path = 0; path < 3; path++)
+		{
+			if (path == 2 && !StaticGeometry::isMultiDrawSupported())
+			{
+				LOGL::log("bool benchmarkStaticGeometry(int count, const std::function<MeshData(MeshBuilder& builder, int index)>& createMesh, const std::function<InstanceData(int index)>& createInstance) -> %-28s not supported by the driver", paths[path]);
+				continue;
+			}
+			geometry.setMultiDraw(path == 2);
+
+			double cpuSeconds = 0.0;
+			GLuint64 gpuNanoseconds = 0;
+			// the first frame uploads and warms up the driver, it isn't counted
+			for (int frame = 0; frame <= MDI_BENCH_FRAMES; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+				start = std::chrono::steady_clock::now();
+				if (path == 0)
+				{
+					for (int i = 0; i < count; i++)
+					{
+						setInstanceAttribs(instances[i]);
+						drawMesh(meshes[i]);
+					}
+				}
+				else
+					geometry.draw();
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				glEndQuery(GL_TIME_ELAPSED);
+				GLuint64 nanoseconds = 0;
+				glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &nanoseconds);
+				if (frame > 0)
+				{
+					cpuSeconds += seconds;
+					gpuNanoseconds += nanoseconds;
+				}
+			}
+			LOGL::log("bool benchmarkStaticGeometry(int count, const std::function<MeshData(MeshBuilder& builder, int index)>& createMesh, const std::function<InstanceData(int index)>& createInstance) -> %-28s CPU %8.3f ms (%6.1f ns/draw)  GPU %8.3f ms",
+				paths[path], cpuSeconds * 1000.0 / MDI_BENCH_FRAMES, cpuSeconds * 1e9 / ((double)MDI_BENCH_FRAMES * count),
+				gpuNanoseconds / 1e6 / MDI_BENCH_FRAMES);
+		}
+
+		glDeleteQueries(1, &timeQuery);
+		for (Mesh& mesh : meshes)
+		{
+			GLuint buffers[] = { mesh.VBO, mesh.EBO };
+			GLState.deleteBuffers(2, buffers);
+			GLState.deleteVertexArrays(1, &mesh.VAO);
+		}
+		geometry.clear();
+		return true;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "Culling.h"
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// initial size of the shared buffers, both double when a mesh doesn't fit
+#define STATIC_GEOMETRY_VERTEX_CAPACITY 65536
+#define STATIC_GEOMETRY_INDEX_CAPACITY 262144
+// frames every path of benchmarkStaticGeometry is timed over
+#define MDI_BENCH_FRAMES 20
+
+namespace LOGL
+{
+    // layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+    // a mesh suballocated from the shared buffers, indices stay relative to baseVertex
+    struct StaticMesh
+    {
+        GLint baseVertex = 0;
+        // lod 0, firstIndex is absolute in the shared index buffer
+        GLuint firstIndex = 0;
+        GLuint indexCount = 0;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        // with absolute firstIndex as well
+        std::vector<MeshLod> lods;
+    };
+
+    struct StaticGeometryStats
+    {
+        size_t draws = 0;
+        // glDraw* calls the last draw() made
+        size_t drawCalls = 0;
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+    };
+
+    // meshes that never change share one vertex and one index buffer; their draws are kept
+    // as indirect commands and InstanceData, command i reads instance i through its
+    // baseInstance, so the whole set is a single glMultiDrawElementsIndirect
+    class StaticGeometry
+    {
+    public:
+        StaticGeometry();
+        void init(VertexLayout layout = VERTEX_LAYOUT_PACKED);
+
+        // copies the vertices and indices, data must use the layout given to init(); 16 bit
+        // indices are widened so every mesh fits one index type; returns the mesh id, -1 on failure
+        GLint addMesh(const MeshData& data);
+        // lod 0 of mesh, draws are uploaded by the next draw()
+        size_t addDraw(GLint mesh, const glm::mat4& model, GLint material);
+        // removes every draw, the meshes stay
+        void clearDraws();
+        // releases the buffers, init() has to be called again
+        void clear();
+
+        // every draw with the bound program: one glMultiDrawElementsIndirect when the driver
+        // supports it and it's enabled, one glDrawElementsBaseVertex per draw otherwise
+        void draw();
+        // only the draws listed in visible, as FrustumCuller::cull() returns them for getBounds()
+        void draw(const std::vector<uint32_t>& visible);
+
+        void setMultiDraw(bool enabled);
+        bool getMultiDraw() const;
+        static bool isMultiDrawSupported();
+
+        const StaticMesh& getMesh(GLint mesh) const;
+        // world space box of every draw, in draw order
+        const BoundingBoxes& getBounds() const;
+        size_t getMeshCount() const;
+        size_t getDrawCount() const;
+        const StaticGeometryStats& getStats() const;
+    private:
+        void reserve(size_t vertexCount, size_t indexCount);
+        // copies the used part of buffer into a new one of capacity bytes and deletes buffer
+        static GLuint grow(GLuint buffer, size_t used, size_t capacity);
+        // both VAOs read the shared buffers, only the multi draw one has the instance attributes
+        void setupVertexArrays();
+        void upload();
+
+        VertexFormat m_Format;
+        GLuint m_MultiDrawVAO = 0;
+        GLuint m_DirectVAO = 0;
+        GLuint m_VertexBuffer = 0;
+        GLuint m_IndexBuffer = 0;
+        GLuint m_CommandBuffer = 0;
+        // commands of the visible draws, refilled by every draw(visible)
+        GLuint m_VisibleBuffer = 0;
+        InstanceBuffer m_InstanceBuffer;
+        size_t m_VertexCount = 0;
+        size_t m_VertexCapacity = 0;
+        size_t m_IndexCount = 0;
+        size_t m_IndexCapacity = 0;
+
+        std::vector<StaticMesh> m_Meshes;
+        std::vector<DrawElementsIndirectCommand> m_Commands;
+        std::vector<InstanceData> m_Instances;
+        BoundingBoxes m_Bounds;
+        std::vector<DrawElementsIndirectCommand> m_VisibleCommands;
+        // draws changed since the last upload()
+        bool m_Dirty = false;
+        bool m_MultiDraw = true;
+        StaticGeometryStats m_Stats;
+    };
+
+    // times count unique meshes from createMesh(builder, i), placed by createInstance(i), drawn with
+    // the bound program from separate VAOs, from StaticGeometry one draw at a time and with one
+    // multi draw indirect
+    bool benchmarkStaticGeometry(int count, const std::function<MeshData(MeshBuilder& builder, int index)>& createMesh, const std::function<InstanceData(int index)>& createInstance);
+}
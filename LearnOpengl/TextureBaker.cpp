@@ -0,0 +1,85 @@
+#include "TextureBaker.h"
+#include "TextureFile.h"
+#include "ImageDecoder.h"
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+#include "logger.h"
+#include <vector>
+
+namespace LOGL
+{
+	// the encoders take RGBA, grey is spread over red, green and blue like stb_image does it
+	static std::shared_ptr<unsigned char> expandToRGBA(const TextureImage& image)
+	{
+		const TextureLevel& level = image.levels[0];
+		int channels = (int)(level.size / ((size_t)level.width * level.height));
+		size_t count = (size_t)level.width * level.height;
+		std::shared_ptr<unsigned char> rgba(new unsigned char[count * 4], std::default_delete<unsigned char[]>());
+		const unsigned char* src = image.data.get() + level.offset;
+		unsigned char* dst = rgba.get();
+		for (size_t i = 0; i < count; i++, src += channels, dst += 4)
+		{
+			dst[0] = src[0];
+			dst[1] = channels >= 3 ? src[1] : src[0];
+			dst[2] = channels >= 3 ? src[2] : src[0];
+			dst[3] = channels == 4 ? src[3] : channels == 2 ? src[1] : 255;
+		}
+		return rgba;
+	}
+
+	bool bakeTexture(const std::string& inputPath, const std::string& outputPath, GLenum format)
+	{
+		// bottom up like loadTextureImage(), the blocks then upload without flipping
+		TextureImage levels;
+		if (!decodeImage(inputPath, levels))
+			return false;
+		int width = levels.levels[0].width;
+		int height = levels.levels[0].height;
+		if (levels.format != GL_RGBA)
+			levels.data = expandToRGBA(levels);
+		levels.internalFormat = GL_RGBA8;
+		levels.format = GL_RGBA;
+		levels.levels.assign(1, { width, height, 0, (size_t)width * height * 4 });
+		const unsigned char* pixels = levels.data.get();
+
+		if (!format)
+		{
+			bool opaque = true;
+			for (size_t i = 3; i < levels.levels[0].size && opaque; i += 4)
+				opaque = pixels[i] == 255;
+			format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+		if (format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT && format != GL_COMPRESSED_RG_RGTC2)
+		{
+			LOGL::error("bool bakeTexture(const std::string& inputPath, const std::string& outputPath, GLenum format) -> no encoder for format 0x%x", format);
+			return false;
+		}
+
+		// BC5 holds data, normal maps aren't gamma encoded
+		generateMipChain(levels, format != GL_COMPRESSED_RG_RGTC2);
+
+		TextureImage image;
+		image.internalFormat = format;
+		size_t size = 0;
+		for (const TextureLevel& level : levels.levels)
+		{
+			image.levels.push_back({ level.width, level.height, size, getCompressedSize(format, level.width, level.height) });
+			size += image.levels.back().size;
+		}
+
+		std::shared_ptr<unsigned char> blocks(new unsigned char[size], std::default_delete<unsigned char[]>());
+		for (size_t i = 0; i < image.levels.size(); i++)
+		{
+			const TextureLevel& level = levels.levels[i];
+			compressImage(levels.data.get() + level.offset, level.width, level.height, format, blocks.get() + image.levels[i].offset);
+		}
+		image.data = blocks;
+
+		if (!saveDDS(outputPath, image))
+			return false;
+
+		LOGL::log("bool bakeTexture(const std::string& inputPath, const std::string& outputPath, GLenum format) -> %s: %dx%d, %d levels, %d KB",
+			outputPath.c_str(), width, height, (int)image.levels.size(), (int)(size >> 10));
+		return true;
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <string>
+
+namespace LOGL
+{
+	// offline conversion of anything decodeImage() reads to a block compressed .dds with the
+	// mip chain of generateMipChain(); format 0 picks BC3 for images with alpha below 255 and BC1 otherwise,
+	// GL_COMPRESSED_RG_RGTC2 (BC5) keeps red and green for normal maps
+	bool bakeTexture(const std::string& inputPath, const std::string& outputPath, GLenum format = 0);
+}
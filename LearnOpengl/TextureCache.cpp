@@ -0,0 +1,150 @@
+#include "TextureCache.h"
+#include "logger.h"
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#ifndef _WIN32
+#include <climits>
+#endif
+
+namespace LOGL
+{
+	// absolute path with resolved links and dot segments, the path itself if it doesn't exist
+	static std::string canonicalPath(const std::string& path)
+	{
+#ifdef _WIN32
+		char resolved[_MAX_PATH];
+		std::string result = _fullpath(resolved, path.c_str(), _MAX_PATH) ? resolved : path;
+		std::replace(result.begin(), result.end(), '\\', '/');
+		std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+		return result;
+#else
+		char resolved[PATH_MAX];
+		return realpath(path.c_str(), resolved) ? resolved : path;
+#endif
+	}
+
+	TextureCache::TextureCache()
+	{
+	}
+
+	void TextureCache::init(TextureStreamer& streamer, size_t budget)
+	{
+		m_Streamer = &streamer;
+		m_Budget = budget;
+	}
+
+	std::shared_ptr<Texture> TextureCache::get(const std::string& path, const TextureParams& params)
+	{
+		std::string key = makeKey(path, params);
+		auto cached = m_Textures.find(key);
+		if (cached != m_Textures.end())
+		{
+			m_Hits++;
+			cached->second->lastUse = m_Frame;
+			return cached->second;
+		}
+
+		m_Misses++;
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+		texture->ID = m_Streamer->request(path, params);
+		texture->path = path;
+		texture->params = params;
+		texture->lastUse = m_Frame;
+		m_Textures[key] = texture;
+		return texture;
+	}
+
+	void TextureCache::update()
+	{
+		m_Frame++;
+
+		m_ResidentBytes = 0;
+		for (auto& entry : m_Textures)
+		{
+			Texture& texture = *entry.second;
+			if (!texture.bytes)
+				texture.bytes = m_Streamer->getSize(texture.ID);
+			m_ResidentBytes += texture.bytes;
+		}
+
+		if (m_ResidentBytes > m_Budget)
+			evict();
+		else
+			m_OverBudget = false;
+	}
+
+	void TextureCache::setBudget(size_t bytes)
+	{
+		m_Budget = bytes;
+	}
+
+	TextureCacheStats TextureCache::getStats() const
+	{
+		TextureCacheStats stats;
+		stats.textures = m_Textures.size();
+		for (const auto& entry : m_Textures)
+		{
+			if (entry.second.use_count() > 1)
+				stats.referenced++;
+			if (m_Streamer->isPending(entry.second->ID))
+				stats.pending++;
+		}
+		stats.residentBytes = m_ResidentBytes;
+		stats.budget = m_Budget;
+		stats.hits = m_Hits;
+		stats.misses = m_Misses;
+		stats.evictions = m_Evictions;
+		return stats;
+	}
+
+	void TextureCache::clear()
+	{
+		for (auto& entry : m_Textures)
+			m_Streamer->release(entry.second->ID);
+		m_Textures.clear();
+		m_ResidentBytes = 0;
+	}
+
+	std::string TextureCache::makeKey(const std::string& path, const TextureParams& params) const
+	{
+		char suffix[96];
+		snprintf(suffix, sizeof(suffix), "|%x|%x|%x|%x|%d|%d|%g", params.wrapS, params.wrapT, params.minFilter, params.magFilter,
+			(int)params.mipmaps, (int)params.srgb, params.alphaCoverage);
+		return canonicalPath(path) + suffix;
+	}
+
+	void TextureCache::evict()
+	{
+		// only textures nobody holds and that finished streaming can go
+		std::vector<std::unordered_map<std::string, std::shared_ptr<Texture>>::iterator> candidates;
+		for (auto entry = m_Textures.begin(); entry != m_Textures.end(); ++entry)
+		{
+			if (entry->second.use_count() == 1 && !m_Streamer->isPending(entry->second->ID))
+				candidates.push_back(entry);
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const decltype(candidates)::value_type& a, const decltype(candidates)::value_type& b)
+		{
+			return a->second->lastUse < b->second->lastUse;
+		});
+
+		for (auto& entry : candidates)
+		{
+			if (m_ResidentBytes <= m_Budget)
+				break;
+			m_ResidentBytes -= entry->second->bytes;
+			m_Streamer->release(entry->second->ID);
+			m_Textures.erase(entry);
+			m_Evictions++;
+		}
+
+		// warn once per overflow instead of every frame
+		bool overBudget = m_ResidentBytes > m_Budget;
+		if (overBudget && !m_OverBudget)
+			LOGL::warning("void TextureCache::evict() -> referenced textures take %d MB, over the %d MB budget",
+				(int)(m_ResidentBytes >> 20), (int)(m_Budget >> 20));
+		m_OverBudget = overBudget;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "TextureStreamer.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// unreferenced textures are evicted, least recently requested first, above this
+#define TEXTURE_CACHE_BUDGET (256 * 1024 * 1024)
+
+namespace LOGL
+{
+	struct Texture
+	{
+		GLuint ID = 0;
+		std::string path;
+		TextureParams params;
+		// size of the uploaded image, 0 while it's streaming
+		size_t bytes = 0;
+		// TextureCache::update() count of the last get()
+		unsigned long long lastUse = 0;
+	};
+
+	struct TextureCacheStats
+	{
+		size_t textures = 0;
+		// textures held by a handle outside the cache
+		size_t referenced = 0;
+		size_t pending = 0;
+		size_t residentBytes = 0;
+		size_t budget = 0;
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+	};
+
+	// one texture per canonical path and sampling parameters, shared by every caller asking for it;
+	// a texture is referenced while a handle outside the cache holds it
+	class TextureCache
+	{
+	public:
+		TextureCache();
+
+		void init(TextureStreamer& streamer, size_t budget = TEXTURE_CACHE_BUDGET);
+
+		std::shared_ptr<Texture> get(const std::string& path, const TextureParams& params = TextureParams());
+
+		// call on the GL thread once per frame after TextureStreamer::update()
+		void update();
+
+		void setBudget(size_t bytes);
+		TextureCacheStats getStats() const;
+
+		// deletes every texture, handles still held keep a dead texture name
+		void clear();
+
+		// equal for every get() that shares a texture
+		std::string makeKey(const std::string& path, const TextureParams& params) const;
+	private:
+		void evict();
+
+		TextureStreamer* m_Streamer = nullptr;
+		std::unordered_map<std::string, std::shared_ptr<Texture>> m_Textures;
+		size_t m_Budget = TEXTURE_CACHE_BUDGET;
+		size_t m_ResidentBytes = 0;
+		bool m_OverBudget = false;
+		unsigned long long m_Frame = 0;
+		size_t m_Hits = 0;
+		size_t m_Misses = 0;
+		size_t m_Evictions = 0;
+	};
+}
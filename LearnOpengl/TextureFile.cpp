@@ -0,0 +1,281 @@
+#include "TextureFile.h"
+#include "BlockCompression.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "logger.h"
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+#define DDS_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define DDSD_CAPS 0x1
+#define DDSD_HEIGHT 0x2
+#define DDSD_WIDTH 0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE 0x80000
+#define DDPF_FOURCC 0x4
+#define DDSCAPS_COMPLEX 0x8
+#define DDSCAPS_TEXTURE 0x1000
+#define DDSCAPS_MIPMAP 0x400000
+
+#define DXGI_FORMAT_BC1_UNORM 71
+#define DXGI_FORMAT_BC3_UNORM 77
+#define DXGI_FORMAT_BC5_UNORM 83
+#define DXGI_FORMAT_BC7_UNORM 98
+#define DDS_DIMENSION_TEXTURE2D 3
+// largest edge loadDDS accepts, GL_MAX_TEXTURE_SIZE of current hardware
+#define DDS_MAX_SIZE 16384
+
+namespace LOGL
+{
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t masks[4];
+	};
+
+	struct DDSHeader
+	{
+		uint32_t magic;
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat pixelFormat;
+		uint32_t caps[4];
+		uint32_t reserved2;
+	};
+	static_assert(sizeof(DDSHeader) == 128, "DDSHeader is read straight from disk");
+
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	bool TextureImage::isCompressed() const
+	{
+		return format == 0;
+	}
+
+	size_t TextureImage::getSize() const
+	{
+		size_t size = 0;
+		for (const TextureLevel& level : levels)
+			size += level.size;
+		return size;
+	}
+
+	bool loadDDS(const std::string& path, TextureImage& image)
+	{
+		std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+		if (!file->open(path))
+			return false;
+
+		const unsigned char* bytes = (const unsigned char*)file->data();
+		DDSHeader header;
+		if (file->size() < sizeof(header))
+		{
+			LOGL::error("bool loadDDS(const std::string& path, TextureImage& image) -> %s is truncated", path.c_str());
+			return false;
+		}
+		memcpy(&header, bytes, sizeof(header));
+		size_t offset = sizeof(header);
+		if (header.magic != DDS_MAGIC || header.size != 124 || !(header.pixelFormat.flags & DDPF_FOURCC))
+		{
+			LOGL::error("bool loadDDS(const std::string& path, TextureImage& image) -> %s isn't a block compressed DDS file", path.c_str());
+			return false;
+		}
+
+		GLenum format = 0;
+		switch (header.pixelFormat.fourCC)
+		{
+		case DDS_FOURCC('D', 'X', 'T', '1'):
+			format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			break;
+		case DDS_FOURCC('D', 'X', 'T', '5'):
+			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			break;
+		case DDS_FOURCC('A', 'T', 'I', '2'):
+		case DDS_FOURCC('B', 'C', '5', 'U'):
+			format = GL_COMPRESSED_RG_RGTC2;
+			break;
+		case DDS_FOURCC('D', 'X', '1', '0'):
+		{
+			DDSHeaderDX10 dx10;
+			if (file->size() < offset + sizeof(dx10))
+				break;
+			memcpy(&dx10, bytes + offset, sizeof(dx10));
+			offset += sizeof(dx10);
+			if (dx10.resourceDimension != DDS_DIMENSION_TEXTURE2D || dx10.arraySize > 1)
+				break;
+			if (dx10.dxgiFormat == DXGI_FORMAT_BC1_UNORM)
+				format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			else if (dx10.dxgiFormat == DXGI_FORMAT_BC3_UNORM)
+				format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			else if (dx10.dxgiFormat == DXGI_FORMAT_BC5_UNORM)
+				format = GL_COMPRESSED_RG_RGTC2;
+			else if (dx10.dxgiFormat == DXGI_FORMAT_BC7_UNORM)
+				format = GL_COMPRESSED_RGBA_BPTC_UNORM;
+			break;
+		}
+		}
+		if (!format)
+		{
+			LOGL::error("bool loadDDS(const std::string& path, TextureImage& image) -> %s has an unsupported format", path.c_str());
+			return false;
+		}
+
+		// a zero edge would divide by zero in the row upload, a huge one turns negative as int
+		if (!header.width || !header.height || header.width > DDS_MAX_SIZE || header.height > DDS_MAX_SIZE)
+		{
+			LOGL::error("bool loadDDS(const std::string& path, TextureImage& image) -> %s has a bad size %ux%u", path.c_str(), header.width, header.height);
+			return false;
+		}
+
+		image.internalFormat = format;
+		image.format = 0;
+		image.levels.clear();
+		int width = (int)header.width;
+		int height = (int)header.height;
+		uint32_t levelCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount ? header.mipMapCount : 1;
+		// the full chain ends at 1x1, floor(log2(max(width, height))) + 1 levels
+		uint32_t maxLevelCount = 1;
+		while ((std::max(width, height) >> maxLevelCount) > 0)
+			maxLevelCount++;
+		levelCount = std::min(levelCount, maxLevelCount);
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			size_t size = getCompressedSize(format, width, height);
+			if (offset + size > file->size())
+			{
+				LOGL::error("bool loadDDS(const std::string& path, TextureImage& image) -> %s is truncated", path.c_str());
+				return false;
+			}
+			image.levels.push_back({ width, height, offset, size });
+			offset += size;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+		}
+
+		// the levels point into the mapping, which stays alive as long as the data
+		image.data = std::shared_ptr<const unsigned char>(file, bytes);
+		return true;
+	}
+
+	bool saveDDS(const std::string& path, const TextureImage& image)
+	{
+		uint32_t fourCC = 0;
+		if (image.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+			fourCC = DDS_FOURCC('D', 'X', 'T', '1');
+		else if (image.internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+			fourCC = DDS_FOURCC('D', 'X', 'T', '5');
+		else if (image.internalFormat == GL_COMPRESSED_RG_RGTC2)
+			fourCC = DDS_FOURCC('A', 'T', 'I', '2');
+		else if (image.internalFormat == GL_COMPRESSED_RGBA_BPTC_UNORM)
+			fourCC = DDS_FOURCC('D', 'X', '1', '0');
+		if (!fourCC || image.levels.empty())
+		{
+			LOGL::error("bool saveDDS(const std::string& path, const TextureImage& image) -> only block compressed images can be saved");
+			return false;
+		}
+
+		DDSHeader header = {};
+		header.magic = DDS_MAGIC;
+		header.size = 124;
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.width = image.levels[0].width;
+		header.height = image.levels[0].height;
+		header.pitchOrLinearSize = (uint32_t)image.levels[0].size;
+		header.mipMapCount = (uint32_t)image.levels.size();
+		header.pixelFormat.size = sizeof(DDSPixelFormat);
+		header.pixelFormat.flags = DDPF_FOURCC;
+		header.pixelFormat.fourCC = fourCC;
+		header.caps[0] = DDSCAPS_TEXTURE | (image.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			LOGL::error("bool saveDDS(const std::string& path, const TextureImage& image) -> can't write %s", path.c_str());
+			return false;
+		}
+		file.write((const char*)&header, sizeof(header));
+		if (image.internalFormat == GL_COMPRESSED_RGBA_BPTC_UNORM)
+		{
+			DDSHeaderDX10 dx10 = { DXGI_FORMAT_BC7_UNORM, DDS_DIMENSION_TEXTURE2D, 0, 1, 0 };
+			file.write((const char*)&dx10, sizeof(dx10));
+		}
+		for (const TextureLevel& level : image.levels)
+			file.write((const char*)image.data.get() + level.offset, level.size);
+
+		if (!file.good())
+		{
+			LOGL::error("bool saveDDS(const std::string& path, const TextureImage& image) -> writing %s failed", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// RGBA8 levels of a block compressed image
+	static bool decompressLevels(const std::string& path, TextureImage& image)
+	{
+		std::vector<TextureLevel> levels;
+		size_t size = 0;
+		for (const TextureLevel& level : image.levels)
+		{
+			levels.push_back({ level.width, level.height, size, (size_t)level.width * level.height * 4 });
+			size += levels.back().size;
+		}
+
+		std::shared_ptr<unsigned char> rgba(new unsigned char[size], std::default_delete<unsigned char[]>());
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			const TextureLevel& level = image.levels[i];
+			if (!decompressImage(image.data.get() + level.offset, level.width, level.height, image.internalFormat, rgba.get() + levels[i].offset))
+			{
+				LOGL::error("bool decompressLevels(const std::string& path, TextureImage& image) -> %s: the driver can't sample its format and there's no CPU decoder", path.c_str());
+				return false;
+			}
+		}
+
+		image.internalFormat = GL_RGBA8;
+		image.format = GL_RGBA;
+		image.levels = levels;
+		image.data = rgba;
+		return true;
+	}
+
+	bool loadTextureImage(const std::string& path, TextureImage& image)
+	{
+		size_t dot = path.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+		for (char& c : extension)
+			c = (char)tolower(c);
+
+		if (extension == ".dds")
+		{
+			if (!loadDDS(path, image))
+				return false;
+			if (!isCompressedFormatSupported(image.internalFormat))
+				return decompressLevels(path, image);
+			return true;
+		}
+
+		return decodeImage(path, image);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "glad/glad.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LOGL
+{
+    struct TextureLevel
+    {
+        int width;
+        int height;
+        // into TextureImage::data
+        size_t offset;
+        size_t size;
+    };
+
+    // decoded or block compressed image with its mip levels, rows bottom up as GL expects them
+    struct TextureImage
+    {
+        GLenum internalFormat = 0;
+        // pixel transfer format, 0 for block compressed images
+        GLenum format = 0;
+        std::vector<TextureLevel> levels;
+        // a decoder's buffer or a file mapping, released with the last copy
+        std::shared_ptr<const unsigned char> data;
+
+        bool isCompressed() const;
+        size_t getSize() const;
+    };
+
+    // .dds with BC1 (DXT1), BC3 (DXT5), BC5 (ATI2/BC5U) or DX10 BC7; the file is mapped, not read.
+    // rows are stored bottom up like the PNGs loadTexture flips, so blocks upload unchanged
+    bool loadDDS(const std::string& path, TextureImage& image);
+    bool saveDDS(const std::string& path, const TextureImage& image);
+
+    // .dds files or anything decodeImage() reads; compressed formats the driver
+    // can't sample are decoded to RGBA8 on the CPU
+    bool loadTextureImage(const std::string& path, TextureImage& image);
+}
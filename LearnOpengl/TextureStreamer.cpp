@@ -0,0 +1,405 @@
+#include "TextureStreamer.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "MipGenerator.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+
+namespace LOGL
+{
+	TextureStreamer::TextureStreamer()
+	{
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		stopWorkers();
+	}
+
+	void TextureStreamer::init(unsigned int threadCount, size_t frameBudget)
+	{
+		m_FrameBudget = frameBudget;
+
+		// the highest level GL accepts, above the mips of any image that fits
+		GLint maxSize = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+		m_PlaceholderLevel = 0;
+		while ((maxSize >> (m_PlaceholderLevel + 1)) > 0)
+			m_PlaceholderLevel++;
+
+		GLsizeiptr size = (GLsizeiptr)TEXTURE_STREAMER_SLOT_COUNT * TEXTURE_STREAMER_SLOT_SIZE;
+		glGenBuffers(1, &m_Buffer);
+		GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Buffer);
+		if (GLExt.ARB_buffer_storage)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			GLExt.BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+			m_Mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+			if (!m_Mapped)
+				LOGL::warning("void TextureStreamer::init(unsigned int threadCount, size_t frameBudget) -> persistent mapping failed");
+		}
+		else
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+		m_Running = true;
+		for (unsigned int i = 0; i < threadCount; i++)
+			m_Threads.push_back(std::thread(&TextureStreamer::run, this));
+	}
+
+	void TextureStreamer::shutdown()
+	{
+		stopWorkers();
+
+		for (GLsync& fence : m_Fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+			fence = 0;
+		}
+		if (m_Mapped)
+		{
+			GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			m_Mapped = nullptr;
+		}
+		GLState.deleteBuffers(1, &m_Buffer);
+		m_Buffer = 0;
+	}
+
+	GLuint TextureStreamer::request(const std::string& path, const TextureParams& params)
+	{
+		static const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		GLState.bindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+		// the image streams into levels below the placeholder, which is sampled until the
+		// smallest of them is complete
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, m_PlaceholderLevel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_PlaceholderLevel);
+		glTexImage2D(GL_TEXTURE_2D, m_PlaceholderLevel, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+		GLState.bindTexture(GL_TEXTURE_2D, 0);
+
+		uint64_t serial = ++m_Serial;
+		m_States[texture] = { STATE_PENDING, 0, serial };
+		m_Pending++;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Decode.push_back({ texture, serial, path, params, false, TextureImage(), 0, 0 });
+		}
+		m_Condition.notify_one();
+		return texture;
+	}
+
+	void TextureStreamer::release(GLuint texture)
+	{
+		m_States.erase(texture);
+		GLState.deleteTextures(1, &texture);
+	}
+
+	void TextureStreamer::update()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			while (!m_Decoded.empty())
+			{
+				m_Uploads.push_back(std::move(m_Decoded.front()));
+				m_Decoded.pop_front();
+			}
+		}
+
+		size_t budget = m_FrameBudget;
+		while (!m_Uploads.empty() && budget > 0)
+		{
+			Job& job = m_Uploads.front();
+			if (!job.loaded || !isCurrent(job))
+			{
+				complete(job, STATE_FAILED);
+				m_Uploads.pop_front();
+				continue;
+			}
+			if (!uploadLevels(job, budget))
+				break;
+			complete(job, STATE_READY);
+			m_Uploads.pop_front();
+		}
+	}
+
+	void TextureStreamer::finish()
+	{
+		while (m_Pending)
+		{
+			update();
+			std::this_thread::yield();
+		}
+	}
+
+	bool TextureStreamer::isReady(GLuint texture) const
+	{
+		auto status = m_States.find(texture);
+		return status != m_States.end() && status->second.state == STATE_READY;
+	}
+
+	bool TextureStreamer::isPending(GLuint texture) const
+	{
+		auto status = m_States.find(texture);
+		return status != m_States.end() && status->second.state == STATE_PENDING;
+	}
+
+	size_t TextureStreamer::getSize(GLuint texture) const
+	{
+		auto status = m_States.find(texture);
+		return status != m_States.end() ? status->second.bytes : 0;
+	}
+
+	size_t TextureStreamer::getPendingCount() const
+	{
+		return m_Pending;
+	}
+
+	void TextureStreamer::run()
+	{
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return !m_Running || !m_Decode.empty(); });
+				if (!m_Running)
+					return;
+				job = std::move(m_Decode.front());
+				m_Decode.pop_front();
+			}
+
+			job.loaded = loadTextureImage(job.path, job.image);
+			if (job.loaded && job.params.mipmaps && job.image.levels.size() == 1 && !job.image.isCompressed())
+				generateMipChain(job.image, job.params.srgb, job.params.alphaCoverage);
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Decoded.push_back(std::move(job));
+		}
+	}
+
+	void TextureStreamer::stopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Running = false;
+		}
+		m_Condition.notify_all();
+		for (std::thread& thread : m_Threads)
+			thread.join();
+		m_Threads.clear();
+	}
+
+	bool TextureStreamer::uploadLevels(Job& job, size_t& budget)
+	{
+		const TextureImage& image = job.image;
+		bool compressed = image.isCompressed();
+		// compressed levels go in rows of 4x4 blocks
+		int rowHeight = compressed ? 4 : 1;
+
+		GLState.bindTexture(GL_TEXTURE_2D, job.texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Buffer);
+		bool ringBusy = false;
+		GLint levelCount = (GLint)image.levels.size();
+		while (job.level < image.levels.size() && budget > 0 && !ringBusy)
+		{
+			// smallest level first, a level is sampled once it and the smaller ones are complete
+			GLint levelIndex = levelCount - 1 - (GLint)job.level;
+			const TextureLevel& level = image.levels[levelIndex];
+			int rowCount = (level.height + rowHeight - 1) / rowHeight;
+			size_t rowBytes = level.size / rowCount;
+
+			while (job.nextRow < rowCount && budget > 0)
+			{
+				GLsync& fence = m_Fences[m_Slot];
+				if (fence)
+				{
+					// the GPU still reads this slot, try again next frame instead of stalling
+					if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+					{
+						ringBusy = true;
+						break;
+					}
+					glDeleteSync(fence);
+					fence = 0;
+				}
+
+				// at least one row per slot so rows wider than the budget still make progress
+				size_t rowsLeft = rowCount - job.nextRow;
+				size_t rows = std::min(rowsLeft, std::max((size_t)1, std::min(budget, (size_t)TEXTURE_STREAMER_SLOT_SIZE) / rowBytes));
+				size_t bytes = rows * rowBytes;
+				const unsigned char* source = image.data.get() + level.offset + job.nextRow * rowBytes;
+				int y = job.nextRow * rowHeight;
+				int height = std::min((int)rows * rowHeight, level.height - y);
+
+				// the level is allocated once a slot is free so a 1x1 level that replaces the
+				// placeholder is never left empty for a frame; NULL without a bound buffer
+				if (job.nextRow == 0)
+				{
+					GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+					if (compressed)
+						glCompressedTexImage2D(GL_TEXTURE_2D, levelIndex, image.internalFormat, level.width, level.height, 0, (GLsizei)level.size, NULL);
+					else
+						glTexImage2D(GL_TEXTURE_2D, levelIndex, image.internalFormat, level.width, level.height, 0, image.format, GL_UNSIGNED_BYTE, NULL);
+					GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Buffer);
+				}
+
+				const void* pixels = source;
+				bool direct = bytes > TEXTURE_STREAMER_SLOT_SIZE;
+				if (direct)
+					GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				else
+				{
+					size_t offset = (size_t)m_Slot * TEXTURE_STREAMER_SLOT_SIZE;
+					if (m_Mapped)
+						memcpy(m_Mapped + offset, source, bytes);
+					else
+					{
+						void* slot = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+						memcpy(slot, source, bytes);
+						glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+					}
+					pixels = (const void*)offset;
+				}
+
+				if (compressed)
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, levelIndex, 0, y, level.width, height, image.internalFormat, (GLsizei)bytes, pixels);
+				else
+					glTexSubImage2D(GL_TEXTURE_2D, levelIndex, 0, y, level.width, height, image.format, GL_UNSIGNED_BYTE, pixels);
+
+				if (direct)
+					GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_Buffer);
+				else
+				{
+					fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+					m_Slot = (m_Slot + 1) % TEXTURE_STREAMER_SLOT_COUNT;
+				}
+
+				job.nextRow += (int)rows;
+				budget -= std::min(budget, bytes);
+			}
+
+			if (job.nextRow >= rowCount)
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelIndex);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+				job.level++;
+				job.nextRow = 0;
+			}
+		}
+		GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		bool done = job.level >= image.levels.size();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		GLState.bindTexture(GL_TEXTURE_2D, 0);
+		return done;
+	}
+
+	void TextureStreamer::complete(Job& job, State state)
+	{
+		size_t bytes = 0;
+		if (state == STATE_READY)
+		{
+			bytes = job.image.getSize();
+			// drivers pad GL_RGB8 texels to four bytes
+			if (job.image.format == GL_RGB)
+				bytes = bytes / 3 * 4;
+		}
+
+		job.image = TextureImage();
+		m_Pending--;
+
+		// released while it was in flight
+		auto status = m_States.find(job.texture);
+		if (status != m_States.end() && status->second.serial == job.serial)
+			status->second = { state, bytes, job.serial };
+	}
+
+	bool TextureStreamer::isCurrent(const Job& job) const
+	{
+		auto status = m_States.find(job.texture);
+		return status != m_States.end() && status->second.serial == job.serial;
+	}
+
+	bool benchmarkStreaming(TextureStreamer& streamer, const std::string& path, int count)
+	{
+		if (count <= 0)
+			return false;
+		// requests of the scene would be timed too
+		streamer.finish();
+
+		std::vector<GLuint> textures;
+		for (int i = 0; i < count; i++)
+			textures.push_back(streamer.request(path));
+		int frames = 0;
+		double total = 0.0, worst = 0.0;
+		while (streamer.getPendingCount())
+		{
+			auto start = std::chrono::steady_clock::now();
+			streamer.update();
+			glFinish();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			total += seconds;
+			worst = std::max(worst, seconds);
+			frames++;
+			// the workers decode while the render loop draws a frame
+			std::this_thread::sleep_for(std::chrono::milliseconds(16));
+		}
+		bool passed = true;
+		for (GLuint texture : textures)
+		{
+			passed = passed && streamer.isReady(texture);
+			streamer.release(texture);
+		}
+		LOGL::log("bool benchmarkStreaming(TextureStreamer& streamer, const std::string& path, int count) -> %d x %s streamed over %d frames: "
+			"worst update %.2f ms, average %.2f ms", count, path.c_str(), frames, worst * 1000.0, total * 1000.0 / std::max(frames, 1));
+
+		// what the same textures cost loaded in the frame that needs them
+		auto start = std::chrono::steady_clock::now();
+		textures.assign(count, 0);
+		glGenTextures(count, textures.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (GLuint texture : textures)
+		{
+			TextureImage image;
+			if (!loadTextureImage(path, image))
+			{
+				passed = false;
+				break;
+			}
+			if (image.levels.size() == 1 && !image.isCompressed())
+				generateMipChain(image);
+			GLState.bindTexture(GL_TEXTURE_2D, texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+			for (size_t i = 0; i < image.levels.size(); i++)
+			{
+				const TextureLevel& level = image.levels[i];
+				if (image.isCompressed())
+					glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, image.internalFormat, level.width, level.height, 0, (GLsizei)level.size, image.data.get() + level.offset);
+				else
+					glTexImage2D(GL_TEXTURE_2D, (GLint)i, image.internalFormat, level.width, level.height, 0, image.format, GL_UNSIGNED_BYTE, image.data.get() + level.offset);
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		GLState.bindTexture(GL_TEXTURE_2D, 0);
+		glFinish();
+		double blocking = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		GLState.deleteTextures(count, textures.data());
+		LOGL::log("bool benchmarkStreaming(TextureStreamer& streamer, const std::string& path, int count) -> %d x %s loaded in one frame: %.2f ms",
+			count, path.c_str(), blocking * 1000.0);
+		return passed;
+	}
+}
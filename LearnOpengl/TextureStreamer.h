@@ -0,0 +1,131 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "TextureFile.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+// pixel unpack ring, one fence per slot
+#define TEXTURE_STREAMER_SLOT_COUNT 3
+#define TEXTURE_STREAMER_SLOT_SIZE (4 * 1024 * 1024)
+// bytes update() moves through the ring per frame
+#define TEXTURE_STREAMER_FRAME_BUDGET (4 * 1024 * 1024)
+
+namespace LOGL
+{
+	struct TextureParams
+	{
+		GLint wrapS = GL_REPEAT;
+		GLint wrapT = GL_REPEAT;
+		GLint minFilter = GL_LINEAR;
+		GLint magFilter = GL_LINEAR;
+		// generated on the decoding thread, see generateMipChain()
+		bool mipmaps = true;
+		// color is sRGB encoded, mips average it in linear space
+		bool srgb = true;
+		// alpha test reference whose coverage the mips keep, 0 for blended alpha
+		float alphaCoverage = 0.0f;
+	};
+
+	// decodes images on worker threads and uploads them from the GL thread through a ring
+	// of pixel unpack buffers, persistently mapped with GL_ARB_buffer_storage; a requested
+	// texture shows a grey placeholder until its smallest mip is uploaded, then each larger
+	// mip once its last row is, by lowering GL_TEXTURE_BASE_LEVEL.
+	// .dds files upload their compressed mips as they are, see loadTextureImage()
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer();
+		~TextureStreamer();
+
+		// 0 threads starts one per core but the GL thread's, at least one
+		void init(unsigned int threadCount = 0, size_t frameBudget = TEXTURE_STREAMER_FRAME_BUDGET);
+		// stops the workers and deletes the ring, requested textures stay valid
+		void shutdown();
+
+		// returns the texture at once, its image follows in a later update()
+		GLuint request(const std::string& path, const TextureParams& params = TextureParams());
+		// deletes the texture, a pending image is dropped once decoded
+		void release(GLuint texture);
+
+		// call on the GL thread once per frame; images larger than the budget take several frames
+		void update();
+		// runs update() until every request is uploaded or failed
+		void finish();
+
+		bool isReady(GLuint texture) const;
+		bool isPending(GLuint texture) const;
+		// bytes of the uploaded image including mips, 0 until ready
+		size_t getSize(GLuint texture) const;
+		size_t getPendingCount() const;
+	private:
+		enum State
+		{
+			STATE_PENDING,
+			STATE_READY,
+			STATE_FAILED
+		};
+
+		struct Status
+		{
+			State state;
+			size_t bytes;
+			// request() that made the texture, GL reuses released names
+			uint64_t serial;
+		};
+
+		struct Job
+		{
+			GLuint texture;
+			// a job whose serial no longer matches m_States belongs to a released texture
+			uint64_t serial;
+			std::string path;
+			TextureParams params;
+			bool loaded;
+			TextureImage image;
+			// levels already uploaded, smallest first, and the rows of the next one, block rows if compressed
+			size_t level;
+			int nextRow;
+		};
+
+		void run();
+		void stopWorkers();
+		// uploads rows of job until it's done, the budget is spent or the ring is busy
+		bool uploadLevels(Job& job, size_t& budget);
+		void complete(Job& job, State state);
+		// false once the texture of job was released, even if its name was handed out again
+		bool isCurrent(const Job& job) const;
+
+		std::vector<std::thread> m_Threads;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Running = false;
+		std::deque<Job> m_Decode;
+		std::deque<Job> m_Decoded;
+
+		// GL thread only
+		std::deque<Job> m_Uploads;
+		std::unordered_map<GLuint, Status> m_States;
+		size_t m_Pending = 0;
+		uint64_t m_Serial = 0;
+		size_t m_FrameBudget = TEXTURE_STREAMER_FRAME_BUDGET;
+		// holds the 1x1 placeholder, above every level an image can have
+		GLint m_PlaceholderLevel = 0;
+
+		GLuint m_Buffer = 0;
+		// null without GL_ARB_buffer_storage, slots are then mapped one at a time
+		unsigned char* m_Mapped = nullptr;
+		GLsync m_Fences[TEXTURE_STREAMER_SLOT_COUNT] = {};
+		unsigned int m_Slot = 0;
+	};
+
+	// requests count copies of path and times every update() until they are uploaded, then
+	// decodes and uploads count copies in one blocking frame; logs the worst and average frames
+	bool benchmarkStreaming(TextureStreamer& streamer, const std::string& path, int count);
+}
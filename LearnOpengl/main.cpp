@@ -4,13 +4,34 @@
 
 #include "main.h"
 #include "logger.h"
+#include "GLExtensions.h"
+#include "GLState.h"
 #include "BasicLightning.h"
+#include "FrameConstants.h"
+#include "DeferredLightning.h"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "MeshConverter.h"
+#include "Camera.h"
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include "MaterialTable.h"
+#include "RenderQueue.h"
+#include "StaticGeometry.h"
+#include "Culling.h"
+#include "TextureBaker.h"
+#include "ImageDecoder.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -18,6 +39,8 @@
 
 #define WIDTH 1280
 #define HEIGHT 720
+// RenderQueue pass of the lit geometry
+#define PASS_OPAQUE 0
 
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
@@ -26,26 +49,70 @@ glm::mat4 model;
 glm::mat4 projection;
 
 LOGL::Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+LOGL::FrameConstants frameConstants;
+int viewportWidth = WIDTH;
+int viewportHeight = HEIGHT;
 float lastX = WIDTH;
 float lastY = HEIGHT;
 bool firstMouse = true;
 
-struct Vertex
-{
-	float position[3];
-	float texture[2];
-	float normal[3];
-};
-
 bool isMenuOpened = false;
 
 LOGL::BasicLightning basicLightning;
-unsigned int texBoxDiffuse;
-unsigned int texBoxReflect;
-unsigned int cubeVAO;
-
-int main()
+LOGL::DeferredLightning deferredLightning;
+bool deferredShading = false;
+// deferredShading once the deferred programs finished compiling
+bool deferredActive = false;
+bool specular = true;
+LOGL::TextureStreamer textureStreamer;
+LOGL::TextureCache textureCache;
+// every material's textures live in array layers bound once per frame
+LOGL::MaterialTable materialTable;
+GLint boxMaterial = 0;
+GLint metalMaterial = 0;
+LOGL::Mesh cube;
+LOGL::Mesh cubeInstanced;
+LOGL::InstanceBuffer cubeInstances;
+// scene() submits its draws here, they run sorted by state
+LOGL::RenderQueue renderQueue;
+// cubes drawn around the box with one instanced draw
+int gridSize = 0;
+// unique rocks suballocated from shared buffers, one multi draw indirect when the driver has it
+LOGL::StaticGeometry staticGeometry;
+int rockCount = 0;
+bool multiDraw = true;
+// the rocks and the cube grid only draw what intersects the camera's frustum
+LOGL::FrustumCuller culler;
+bool frustumCulling = true;
+// vertex shader invocations of scene(), read a frame late so the query never stalls
+GLuint statsQuery = 0;
+GLuint64 vertexInvocations = 0;
+
+int main(int argc, char** argv)
 {
+	// LearnOpengl --convert model.obj model.mesh
+	if (argc == 4 && std::string(argv[1]) == "--convert")
+		return LOGL::convertMesh(argv[2], argv[3]) ? 0 : -1;
+	// LearnOpengl --bake texture.png texture.dds [bc1|bc3|bc5]
+	if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--bake")
+	{
+		std::string format = argc == 5 ? argv[4] : "";
+		GLenum compressed = 0;
+		if (format == "bc1")
+			compressed = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		else if (format == "bc3")
+			compressed = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		else if (format == "bc5")
+			compressed = GL_COMPRESSED_RG_RGTC2;
+		return LOGL::bakeTexture(argv[2], argv[3], compressed) ? 0 : -1;
+	}
+	// LearnOpengl --decode-bench res/*.png photos/*.jpg
+	if (argc >= 3 && std::string(argv[1]) == "--decode-bench")
+		return LOGL::benchmarkDecode(std::vector<std::string>(argv + 2, argv + argc)) ? 0 : -1;
+	// LearnOpengl --cull-bench [objects]
+	if ((argc == 2 || argc == 3) && std::string(argv[1]) == "--cull-bench")
+		return LOGL::benchmarkCulling(argc == 3 ? std::atoi(argv[2]) : 1000000) ? 0 : -1;
+
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -65,6 +132,8 @@ int main()
 		LOGL::error("Failed to initialize GLAD");
 		return -1;
 	}
+	LOGL::loadExtensions((GLADloadproc)glfwGetProcAddress);
+	LOGL::Shader::enableHotReload();
 
 	glViewport(0, 0, WIDTH, HEIGHT);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -83,7 +152,9 @@ int main()
 
 	projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
 
+	frameConstants.init();
 	basicLightning.init();
+	deferredLightning.init(basicLightning);
 	LOGL::LightSource dirls;
 	dirls.isDirLight = true;
 	dirls.direction = glm::vec3(0.0f, -1.0f, 0.0f);
@@ -99,12 +170,96 @@ int main()
 	dirls.specular = glm::vec3(1.0f, 1.0f, 1.0f);
 	basicLightning.addLightSource(dirls);
 
-	texBoxDiffuse = loadTexture("res/box_diffuse.png");
-	texBoxReflect = loadTexture("res/box_reflect.png");
-
-	glEnable(GL_DEPTH_TEST);
-
-	cubeVAO = createCube();
+	textureStreamer.init();
+	textureCache.init(textureStreamer);
+	materialTable.init(textureCache, textureStreamer);
+	LOGL::MaterialDesc material;
+	material.diffuse = "res/box_diffuse.png";
+	material.specular = "res/box_reflect.png";
+	boxMaterial = materialTable.add(material);
+	material.diffuse = "res/box_reflect.png";
+	material.shininess = 128.0f;
+	metalMaterial = materialTable.add(material);
+
+	LOGL::GLState.enable(GL_DEPTH_TEST);
+
+	cube = createCube();
+	cubeInstances.init();
+	cubeInstanced = createCube(&cubeInstances);
+	staticGeometry.init();
+	culler.init();
+	if (LOGL::GLExt.ARB_pipeline_statistics_query)
+		glGenQueries(1, &statsQuery);
+
+	// benchmarks that need the renderer, they exit once done
+	std::string mode = argc >= 2 ? argv[1] : "";
+	bool benchmark = true;
+	bool passed = false;
+	// LearnOpengl --mdi-bench [meshes]
+	if ((argc == 2 || argc == 3) && mode == "--mdi-bench")
+	{
+		int count = argc == 3 ? std::atoi(argv[2]) : 50000;
+		bindBenchShading(viewportWidth, viewportHeight);
+		passed = LOGL::benchmarkStaticGeometry(count, createRock, [count](int index) {
+			return LOGL::makeInstance(rockTransform(index, count), index % 2 ? metalMaterial : boxMaterial);
+		});
+	}
+	// LearnOpengl --light-bench [lights]
+	else if ((argc == 2 || argc == 3) && mode == "--light-bench")
+	{
+		// a floor of cubes under the box, with the real materials instead of the placeholder
+		gridSize = 100;
+		textureStreamer.finish();
+		textureCache.update();
+		materialTable.update();
+		while (!deferredLightning.isReady())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		passed = LOGL::benchmarkLights(basicLightning, argc == 3 ? std::atoi(argv[2]) : 0, drawBenchFrame);
+	}
+	// LearnOpengl --instance-bench [cubes]
+	else if ((argc == 2 || argc == 3) && mode == "--instance-bench")
+	{
+		bindBenchShading(viewportWidth, viewportHeight);
+		passed = LOGL::benchmarkInstancing(argc == 3 ? std::atoi(argv[2]) : 100000, cube, cubeInstanced, cubeInstances, boxMaterial);
+	}
+	// LearnOpengl --vertex-bench [segments]
+	else if ((argc == 2 || argc == 3) && mode == "--vertex-bench")
+		passed = LOGL::benchmarkVertices(basicLightning, argc == 3 ? std::atoi(argv[2]) : 256, boxMaterial, statsQuery, bindBenchShading);
+	// LearnOpengl --fragment-bench
+	else if (argc == 2 && mode == "--fragment-bench")
+	{
+		textureStreamer.finish();
+		textureCache.update();
+		materialTable.update();
+		passed = LOGL::benchmarkFragments(basicLightning, boxMaterial, bindBenchShading);
+	}
+	// LearnOpengl --startup-bench
+	else if (argc == 2 && mode == "--startup-bench")
+		passed = LOGL::benchmarkStartup();
+	// LearnOpengl --mesh-bench model.obj model.mesh
+	else if (argc == 4 && mode == "--mesh-bench")
+		passed = LOGL::benchmarkMeshLoad(argv[2], argv[3]);
+	// LearnOpengl --stream-bench [textures]
+	else if ((argc == 2 || argc == 3) && mode == "--stream-bench")
+		passed = LOGL::benchmarkStreaming(textureStreamer, "res/box_diffuse.png", argc == 3 ? std::atoi(argv[2]) : 200);
+	// LearnOpengl --layout-bench [segments]
+	else if ((argc == 2 || argc == 3) && mode == "--layout-bench")
+		passed = LOGL::benchmarkVertexLayouts(argc == 3 ? std::atoi(argv[2]) : 512);
+	// LearnOpengl --uniform-bench [calls]
+	else if ((argc == 2 || argc == 3) && mode == "--uniform-bench")
+		passed = LOGL::benchmarkUniforms(argc == 3 ? std::atoi(argv[2]) : 1000000);
+	else
+		benchmark = false;
+	if (benchmark)
+	{
+		culler.shutdown();
+		staticGeometry.clear();
+		materialTable.clear();
+		textureCache.clear();
+		textureStreamer.shutdown();
+		glfwTerminate();
+		return passed ? 0 : -1;
+	}
 
 	// render loop
 	while (!glfwWindowShouldClose(window))
@@ -124,15 +279,37 @@ int main()
 		glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		LOGL::Shader::reloadChanged();
+		textureStreamer.update();
+		textureCache.update();
+		materialTable.update();
+		frameConstants.update(camera, projection, currentFrame, viewportWidth, viewportHeight);
+		deferredActive = deferredShading && deferredLightning.isReady();
+		if (!deferredActive)
+			basicLightning.assignLights(camera, projection);
+		bool measure = statsQuery && readStatsQuery();
+		if (measure)
+			glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, statsQuery);
 		scene();
+		if (measure)
+			glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
 
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// the ImGui backend restores what it changes, validation would catch it if it didn't
+		if (LOGL::GLState.getValidation())
+			LOGL::GLState.validate();
+		LOGL::GLState.endFrame();
 
 		glfwPollEvents();
 		glfwSwapBuffers(window);
 	}
 
+	culler.shutdown();
+	staticGeometry.clear();
+	materialTable.clear();
+	textureCache.clear();
+	textureStreamer.shutdown();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -143,6 +320,8 @@ int main()
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	glViewport(0, 0, width, height);
+	viewportWidth = width;
+	viewportHeight = height;
 }
 
 
@@ -179,31 +358,13 @@ void processInput(GLFWwindow* window)
 		camera.ProcessKeyboard(LOGL::DOWN, deltaTime);
 }
 
-GLuint loadTexture(std::string name) {
-	int width, height, channels;
-	unsigned char* data = stbi_load(name.c_str(), &width, &height, &channels, 0);
-
-	GLuint texture;
-
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	stbi_set_flip_vertically_on_load(true);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, channels == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	stbi_image_free(data);
-
-	return texture;
+std::shared_ptr<LOGL::Texture> loadTexture(std::string name) {
+	return textureCache.get(name);
 }
 
-unsigned int createCube()
+LOGL::Mesh createCube(LOGL::InstanceBuffer* instances)
 {
-	Vertex vertices[] = {
+	LOGL::Vertex vertices[] = {
 		// Back face
 		{{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
 		{{0.5f, -0.5f, -0.5f}, {1.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
@@ -252,32 +413,84 @@ unsigned int createCube()
 		{{-0.5f,  0.5f,  0.5f}, {0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
 		{{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}}
 	};
-	unsigned int VBO, VAO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
+	// welded to 24 vertices and 36 indices
+	LOGL::MeshBuilder builder;
+	builder.addTriangles(vertices, sizeof(vertices) / sizeof(vertices[0]));
+	return builder.build(instances);
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+LOGL::MeshData createRock(LOGL::MeshBuilder& builder, unsigned int seed)
+{
+	// a cube whose corners are pushed around, so every seed gives different vertex data
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> jitter(-0.2f, 0.2f);
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; i++)
+		corners[i] = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f) + glm::vec3(jitter(random), jitter(random), jitter(random));
+
+	// corners of each face counter-clockwise seen from outside
+	static const int faces[6][4] = { {0, 2, 3, 1}, {4, 5, 7, 6}, {0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3} };
+	static const float uvs[4][2] = { {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f} };
+	static const int triangles[6] = { 0, 1, 2, 2, 3, 0 };
+	LOGL::Vertex vertices[36];
+	for (int face = 0; face < 6; face++)
+	{
+		for (int triangle = 0; triangle < 2; triangle++)
+		{
+			const int* corner = triangles + triangle * 3;
+			glm::vec3 a = corners[faces[face][corner[0]]];
+			glm::vec3 b = corners[faces[face][corner[1]]];
+			glm::vec3 c = corners[faces[face][corner[2]]];
+			glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+			for (int i = 0; i < 3; i++)
+			{
+				LOGL::Vertex& vertex = vertices[face * 6 + triangle * 3 + i];
+				glm::vec3 position = corners[faces[face][corner[i]]];
+				vertex = { {position.x, position.y, position.z}, {uvs[corner[i]][0], uvs[corner[i]][1]}, {normal.x, normal.y, normal.z} };
+			}
+		}
+	}
+	builder = LOGL::MeshBuilder();
+	builder.setLogging(false);
+	builder.addTriangles(vertices, 36);
+	return builder.finish();
+}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+glm::mat4 rockTransform(int index, int count)
+{
+	int side = (int)std::ceil(std::sqrt((float)count));
+	glm::vec3 position((index % side - side / 2) * 1.5f, 2.0f, -(index / side) * 1.5f - 2.0f);
+	return glm::translate(glm::mat4(1.0f), position);
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+void buildRocks(int count)
+{
+	staticGeometry.clear();
+	staticGeometry.init();
+	LOGL::MeshBuilder builder;
+	for (int i = 0; i < count; i++)
+	{
+		GLint mesh = staticGeometry.addMesh(createRock(builder, i));
+		if (mesh >= 0)
+			staticGeometry.addDraw(mesh, rockTransform(i, count), i % 2 ? metalMaterial : boxMaterial);
+	}
+}
 
-	return VAO;
+void drawBenchFrame(bool deferred)
+{
+	deferredActive = deferred;
+	frameConstants.update(camera, projection, 0.0f, viewportWidth, viewportHeight);
+	if (!deferredActive)
+		basicLightning.assignLights(camera, projection);
+	scene();
 }
 
-void drawCube(unsigned int VAO)
+void bindBenchShading(int width, int height)
 {
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	frameConstants.update(camera, projection, 0.0f, width, height);
+	basicLightning.assignLights(camera, projection);
+	basicLightning.use();
+	materialTable.bind();
 }
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
@@ -306,20 +519,131 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 	camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
+bool readStatsQuery()
+{
+	static bool pending = false;
+	if (pending)
+	{
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(statsQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+		glGetQueryObjectui64v(statsQuery, GL_QUERY_RESULT, &vertexInvocations);
+	}
+	pending = true;
+	return true;
+}
+
 void scene()
 {
-	basicLightning.use(camera, projection);
+	if (deferredActive)
+		deferredLightning.use(viewportWidth, viewportHeight);
+	else
+		basicLightning.use();
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texBoxDiffuse);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, texBoxReflect);
+	materialTable.bind();
 	glm::mat4 model = glm::mat4(1.0f);
-	basicLightning.setModelMat(model);
-	drawCube(cubeVAO);
+	renderQueue.submit(PASS_OPAQUE, cube, model, boxMaterial, glm::length(camera.Position - glm::vec3(model[3])));
+
+	LOGL::Frustum frustum = camera.GetFrustum(projection);
+	static std::vector<uint32_t> visible;
+	if (gridSize > 0)
+	{
+		static std::vector<LOGL::InstanceData> instances;
+		static LOGL::BoundingSpheres spheres;
+		static std::vector<LOGL::InstanceData> visibleInstances;
+		if (instances.size() != (size_t)(gridSize * gridSize))
+		{
+			instances.resize(gridSize * gridSize);
+			spheres.clear();
+			for (int i = 0; i < gridSize * gridSize; i++)
+			{
+				glm::vec3 position((i % gridSize - gridSize / 2) * 2.0f, -2.0f, (i / gridSize - gridSize / 2) * 2.0f);
+				GLint material = (i % gridSize + i / gridSize) % 2 ? metalMaterial : boxMaterial;
+				instances[i] = LOGL::makeInstance(glm::translate(glm::mat4(1.0f), position), material);
+				// half the diagonal of the unit cube
+				spheres.add(position, 0.8661f);
+			}
+		}
+		const std::vector<LOGL::InstanceData>* drawn = &instances;
+		if (frustumCulling)
+		{
+			culler.cull(frustum, spheres, visible);
+			visibleInstances.resize(visible.size());
+			for (size_t i = 0; i < visible.size(); i++)
+				visibleInstances[i] = instances[visible[i]];
+			drawn = &visibleInstances;
+		}
+		renderQueue.submitInstanced(PASS_OPAQUE, cubeInstanced, cubeInstances, drawn->data(), drawn->size(), boxMaterial, 0.0f);
+	}
+	renderQueue.execute();
+
+	if (frustumCulling)
+	{
+		culler.cull(frustum, staticGeometry.getBounds(), visible);
+		staticGeometry.draw(visible);
+	}
+	else
+		staticGeometry.draw();
+
+	if (deferredActive)
+		deferredLightning.resolve();
 }
 
 void menu()
 {
+	ImGui::Begin("Renderer");
+	ImGui::Checkbox("Deferred shading", &deferredShading);
+	if (deferredShading && !deferredActive)
+		ImGui::Text("compiling deferred shaders...");
+	ImGui::SliderInt("Cube grid", &gridSize, 0, 300);
+	ImGui::SliderInt("Rocks", &rockCount, 0, 50000);
+	// every rock is a new mesh, rebuild once the slider is let go
+	if (ImGui::IsItemDeactivatedAfterEdit())
+		buildRocks(rockCount);
+	if (LOGL::StaticGeometry::isMultiDrawSupported())
+	{
+		if (ImGui::Checkbox("Multi draw indirect", &multiDraw))
+			staticGeometry.setMultiDraw(multiDraw);
+	}
+	else
+		ImGui::Text("Multi draw indirect: not supported");
+	const LOGL::StaticGeometryStats& rockStats = staticGeometry.getStats();
+	ImGui::Text("Static draws: %d in %d calls, %d vertices", (int)rockStats.draws, (int)rockStats.drawCalls, (int)rockStats.vertexCount);
+	ImGui::Checkbox("Frustum culling", &frustumCulling);
+	if (frustumCulling)
+	{
+		const LOGL::CullStats& cullStats = culler.getStats();
+		ImGui::Text("Rocks visible: %d / %d, %.3f ms on %d threads", (int)cullStats.visible, (int)cullStats.tested, cullStats.milliseconds, (int)cullStats.threads);
+	}
+	if (statsQuery)
+		ImGui::Text("VS invocations: %llu", (unsigned long long)vertexInvocations);
+	const LOGL::GLStateStats& glStats = LOGL::GLState.getStats();
+	ImGui::Text("GL state calls: %d, %d elided", (int)glStats.calls, (int)glStats.elided);
+	bool validate = LOGL::GLState.getValidation();
+	if (ImGui::Checkbox("Validate GL state", &validate))
+		LOGL::GLState.setValidation(validate);
+	if (validate)
+		ImGui::Text("GL state mismatches: %d", (int)glStats.mismatches);
+	const LOGL::RenderQueueStats& queueStats = renderQueue.getStats();
+	ImGui::Text("Draws: %d, %d radix passes", (int)queueStats.draws, (int)queueStats.sortPasses);
+	ImGui::Text("Program binds: %d, %d skipped", (int)queueStats.programChanges, (int)queueStats.programsSkipped);
+	ImGui::Text("VAO binds: %d, %d skipped", (int)queueStats.vaoChanges, (int)queueStats.vaosSkipped);
+	ImGui::Text("Material changes: %d, %d skipped", (int)queueStats.materialChanges, (int)queueStats.materialsSkipped);
+	LOGL::TextureCacheStats textureStats = textureCache.getStats();
+	ImGui::Text("Textures: %d (%d referenced, %d streaming)", (int)textureStats.textures, (int)textureStats.referenced, (int)textureStats.pending);
+	ImGui::Text("Texture memory: %.1f / %.1f MB", textureStats.residentBytes / 1048576.0, textureStats.budget / 1048576.0);
+	ImGui::Text("Texture cache: %d hits, %d misses, %d evicted", (int)textureStats.hits, (int)textureStats.misses, (int)textureStats.evictions);
+	LOGL::MaterialTableStats materialStats = materialTable.getStats();
+	ImGui::Text("Materials: %d, %d layers in %d arrays (%d streaming)", (int)materialStats.materials, (int)materialStats.layers, (int)materialStats.arrays, (int)materialStats.pending);
+	if (ImGui::Checkbox("Specular", &specular))
+	{
+		LOGL::ShaderDefines defines;
+		if (!specular)
+			defines["NO_SPECULAR"] = "";
+		basicLightning.requestVariant(defines);
+	}
+	ImGui::End();
+
 	ImGui::ShowDemoWindow();
 }
\ No newline at end of file
@@ -1,19 +1,43 @@
 #pragma once
 
+#include "glm/glm.hpp"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "TextureCache.h"
+#include <vector>
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 void processInput(GLFWwindow* window);
 
-GLuint loadTexture(std::string name);
+// shared through textureCache, shows a placeholder until textureStreamer has uploaded the image
+std::shared_ptr<LOGL::Texture> loadTexture(std::string name);
+
+// with instances the VAO reads its model matrices from that buffer, see RenderQueue::submitInstanced()
+LOGL::Mesh createCube(LOGL::InstanceBuffer* instances = nullptr);
+
+// a cube with jittered corners, unique per seed; the result points into builder
+LOGL::MeshData createRock(LOGL::MeshBuilder& builder, unsigned int seed);
 
-unsigned int createCube();
+// position of rock index in a field of count rocks
+glm::mat4 rockTransform(int index, int count);
 
-void drawCube(unsigned int VAO);
+// replaces the rocks of staticGeometry with count new meshes
+void buildRocks(int count);
+
+// one frame of scene() for LOGL::benchmarkLights(), lights are assigned on the forward path
+void drawBenchFrame(bool deferred);
+
+// frame constants, clustered lights, program and materials of basicLightning for a width x height target
+void bindBenchShading(int width, int height);
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
+// collects the last statsQuery result, false while it's still in flight
+bool readStatsQuery();
+
 void scene();
 
 void menu();
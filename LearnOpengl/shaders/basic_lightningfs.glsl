@@ -4,78 +4,35 @@ out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;  
+flat in int MaterialIndex;
 
-uniform vec3 viewPos;
+#include "frame_constants.glsl"
+#include "lighting.glsl"
+#include "materials.glsl"
 
-struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
-    float shininess;
-}; 
-uniform Material material;
+// (offset, count) into lightIndices for every cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+// z slice = log(depth) * x + y
+uniform vec2 clusterDepthParams;
 
-struct LightSource
-{
-    int isDirLight;
-
-    vec3 position;
-    vec3 direction;
-    
-    float constant;
-    float linear;
-    float quadratic;  
-    float spotCutoff;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-#define MAX_LIGHT_SOURCE 8 
-uniform LightSource lightSources[MAX_LIGHT_SOURCE];
-uniform int enabledLightSourceCount;
-
-vec3 CalcDirLight(LightSource light, vec3 normal, vec3 viewDir)
-{
-    vec3 lightDir = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    return (ambient + diffuse + specular);
-}  
+// MAX_DIR_LIGHTS and CLUSTER_GRID_* are injected by BasicLightning,
+// DIR_LIGHT_COUNT fixes the directional light count so the loop can be unrolled
+uniform int dirLightIndices[MAX_DIR_LIGHTS];
+#ifndef DIR_LIGHT_COUNT
+uniform int dirLightCount;
+#define DIR_LIGHT_COUNT dirLightCount
+#endif
 
-vec3 CalcPointLight(LightSource light, vec3 normal, vec3 fragPos, vec3 viewDir)
+int clusterIndex()
 {
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance    = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + 
-  			     light.quadratic * (distance * distance));    
-
-    float angle = dot(normalize(light.direction), -normalize(lightDir));
-    angle = max(angle,0); 
-   if(light.spotCutoff <= 90 && acos(angle) > radians(light.spotCutoff))
-       return vec3(0);
-
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    ambient  *= attenuation;
-    diffuse  *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
-} 
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    int z = int(log(max(depth, 1e-4)) * clusterDepthParams.x + clusterDepthParams.y);
+    ivec2 tile = ivec2(gl_FragCoord.xy / viewportSize * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    tile = clamp(tile, ivec2(0), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    z = clamp(z, 0, CLUSTER_GRID_Z - 1);
+    return tile.x + tile.y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+}
 
 void main()
 {
@@ -84,14 +41,30 @@ void main()
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 result = vec3(0);
 
-    for(int i = 0; i < enabledLightSourceCount; i++)
+    // material is sampled once and shared by every light
+    MaterialData material = materials[MaterialIndex];
+    float shininess = material.params.x;
+    vec2 dx = dFdx(TexCoords);
+    vec2 dy = dFdy(TexCoords);
+    vec3 albedo = sampleMaterial(material.layers.x, material.layers.y, TexCoords, dx, dy).rgb;
+#ifdef NO_SPECULAR
+    vec3 specColor = vec3(0);
+#else
+    vec3 specColor = sampleMaterial(material.layers.z, material.layers.w, TexCoords, dx, dy).rgb;
+#endif
+
+    for(int i = 0; i < DIR_LIGHT_COUNT; i++)
+        result += CalcDirLight(fetchLight(dirLightIndices[i]), albedo, specColor, shininess, norm, viewDir);
+
+#ifndef DIR_LIGHTS_ONLY
+    // clusters only hold point and spot lights
+    uvec2 cluster = texelFetch(clusterGrid, clusterIndex()).xy;
+    for(uint i = 0u; i < cluster.y; i++)
     {
-        LightSource light = lightSources[i];
-        if(light.isDirLight == 1)
-            result += CalcDirLight(light, norm, viewDir);
-        else
-            result += CalcPointLight(light, norm, FragPos, viewDir);   
+        LightSource light = fetchLight(int(texelFetch(lightIndices, int(cluster.x + i)).r));
+        result += CalcPointLight(light, albedo, specColor, shininess, norm, FragPos, viewDir);
     }
+#endif
     
     FragColor = vec4(result, 1.0);
-} 
\ No newline at end of file
+} 
@@ -2,21 +2,27 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 layout (location = 2) in vec3 aNormal;
+// per instance from LOGL::InstanceBuffer, constant values from setInstanceAttribs() otherwise
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in mat3 aNormalMatrix;
+layout (location = 10) in int aMaterial;
 
 out vec3 LightColor;
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;  
+flat out int MaterialIndex;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "frame_constants.glsl"
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec4 worldPos = aModel * vec4(aPos, 1.0);
+    gl_Position = viewProj * worldPos;
 
-    Normal = mat3(transpose(inverse(model))) * aNormal; 
+    // computed once per object on the CPU, see LOGL::normalMatrix()
+    Normal = aNormalMatrix * aNormal;
     TexCoords = aTexCoords;
-    FragPos = vec3(model * vec4(aPos, 1.0));
-}
\ No newline at end of file
+    FragPos = worldPos.xyz;
+    MaterialIndex = aMaterial;
+}
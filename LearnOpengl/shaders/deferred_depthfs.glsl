@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D gDepth;
+
+void main()
+{
+    // clears covered pixels for the additive light passes and copies depth into the target
+    float depth = texelFetch(gDepth, ivec2(gl_FragCoord.xy), 0).r;
+    if (depth == 1.0)
+        discard;
+
+    gl_FragDepth = depth;
+    FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+layout (location = 4) in int aLightIndex;
+
+flat out int LightIndex;
+
+void main()
+{
+    // full screen triangle
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+    LightIndex = aLightIndex;
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gSpecular;
+layout (location = 2) out vec4 gNormal;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+flat in int MaterialIndex;
+
+#include "materials.glsl"
+
+void main()
+{
+    MaterialData material = materials[MaterialIndex];
+    vec2 dx = dFdx(TexCoords);
+    vec2 dy = dFdy(TexCoords);
+    gAlbedo = vec4(sampleMaterial(material.layers.x, material.layers.y, TexCoords, dx, dy).rgb, 1.0);
+    // shininess is stored as shininess / 256 in alpha
+    gSpecular = vec4(sampleMaterial(material.layers.z, material.layers.w, TexCoords, dx, dy).rgb, material.params.x / 256.0);
+    gNormal = vec4(normalize(Normal), 0.0);
+}
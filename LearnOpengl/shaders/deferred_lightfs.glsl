@@ -0,0 +1,39 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in int LightIndex;
+
+#include "frame_constants.glsl"
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+#include "lighting.glsl"
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / viewportSize;
+    float depth = texture(gDepth, uv).r;
+    if (depth == 1.0)
+        discard;
+
+    // world position from depth
+    vec4 world = invViewProj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+
+    vec3 albedo = texture(gAlbedo, uv).rgb;
+    vec4 specular = texture(gSpecular, uv);
+    vec3 norm = texture(gNormal, uv).xyz;
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    LightSource light = fetchLight(LightIndex);
+    vec3 result;
+    if(light.isDirLight == 1)
+        result = CalcDirLight(light, albedo, specular.rgb, specular.a * 256.0, norm, viewDir);
+    else
+        result = CalcPointLight(light, albedo, specular.rgb, specular.a * 256.0, norm, fragPos, viewDir);
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aLightSphere;
+layout (location = 4) in int aLightIndex;
+
+flat out int LightIndex;
+
+#include "frame_constants.glsl"
+
+void main()
+{
+    // unit cube scaled to enclose the light's radius
+    gl_Position = viewProj * vec4(aLightSphere.xyz + aPos * 2.0 * aLightSphere.w, 1.0);
+    LightIndex = aLightIndex;
+}
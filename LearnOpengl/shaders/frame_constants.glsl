@@ -0,0 +1,11 @@
+// filled once per frame by LOGL::FrameConstants
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    mat4 invViewProj;
+    vec3 viewPos;
+    float time;
+    vec2 viewportSize;
+};
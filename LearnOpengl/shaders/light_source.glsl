@@ -0,0 +1,39 @@
+// layout of LOGL::LightSourceStd140
+struct LightSource
+{
+    vec3 position;
+    float constant;
+    vec3 direction;
+    float linear;
+    vec3 ambient;
+    float quadratic;
+    vec3 diffuse;
+    float spotCutoff;
+    vec3 specular;
+    int isDirLight;
+};
+
+// five texels per light, same layout as LightSource
+uniform samplerBuffer lightData;
+
+LightSource fetchLight(int i)
+{
+    vec4 t0 = texelFetch(lightData, i * 5);
+    vec4 t1 = texelFetch(lightData, i * 5 + 1);
+    vec4 t2 = texelFetch(lightData, i * 5 + 2);
+    vec4 t3 = texelFetch(lightData, i * 5 + 3);
+    vec4 t4 = texelFetch(lightData, i * 5 + 4);
+
+    LightSource light;
+    light.position = t0.xyz;
+    light.constant = t0.w;
+    light.direction = t1.xyz;
+    light.linear = t1.w;
+    light.ambient = t2.xyz;
+    light.quadratic = t2.w;
+    light.diffuse = t3.xyz;
+    light.spotCutoff = t3.w;
+    light.specular = t4.xyz;
+    light.isDirLight = floatBitsToInt(t4.w);
+    return light;
+}
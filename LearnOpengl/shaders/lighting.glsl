@@ -0,0 +1,50 @@
+// shading shared by the forward and deferred paths, NO_SPECULAR drops the specular term
+#include "light_source.glsl"
+
+vec3 CalcDirLight(LightSource light, vec3 albedo, vec3 specColor, float shininess, vec3 normal, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // combine results
+    vec3 ambient  = light.ambient  * albedo;
+    vec3 diffuse  = light.diffuse  * diff * albedo;
+#ifdef NO_SPECULAR
+    return (ambient + diffuse);
+#else
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = light.specular * spec * specColor;
+    return (ambient + diffuse + specular);
+#endif
+}  
+
+vec3 CalcPointLight(LightSource light, vec3 albedo, vec3 specColor, float shininess, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // attenuation
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + 
+  			     light.quadratic * (distance * distance));    
+
+    float angle = dot(normalize(light.direction), -normalize(lightDir));
+    angle = max(angle,0); 
+   if(light.spotCutoff <= 90 && acos(angle) > radians(light.spotCutoff))
+       return vec3(0);
+
+    // combine results
+    vec3 ambient  = light.ambient  * albedo;
+    vec3 diffuse  = light.diffuse  * diff * albedo;
+#ifdef NO_SPECULAR
+    return (ambient + diffuse) * attenuation;
+#else
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = light.specular * spec * specColor;
+    return (ambient + diffuse + specular) * attenuation;
+#endif
+} 
@@ -0,0 +1,74 @@
+// filled by LOGL::MaterialTable, MAX_MATERIALS and MATERIAL_ARRAY_COUNT are injected with the other limits
+struct MaterialData
+{
+    // diffuse array, diffuse layer, specular array, specular layer; array -1 is still streaming
+    ivec4 layers;
+    // x shininess
+    vec4 params;
+};
+
+layout (std140) uniform Materials
+{
+    MaterialData materials[MAX_MATERIALS];
+};
+
+// one array per texture size and format, as many as the driver has units for
+uniform sampler2DArray materialArrays[MATERIAL_ARRAY_COUNT];
+
+// GLSL 3.30 only indexes sampler arrays with constants
+#define SAMPLE_MATERIAL_ARRAY(i) if (array == i) return textureGrad(materialArrays[i], coord, dx, dy)
+
+// the array differs between fragments of one draw, gradients are taken outside
+// the branches so the mip selection stays defined
+vec4 sampleMaterial(int array, int layer, vec2 uv, vec2 dx, vec2 dy)
+{
+    vec3 coord = vec3(uv, float(layer));
+    SAMPLE_MATERIAL_ARRAY(0);
+#if MATERIAL_ARRAY_COUNT > 1
+    SAMPLE_MATERIAL_ARRAY(1);
+#endif
+#if MATERIAL_ARRAY_COUNT > 2
+    SAMPLE_MATERIAL_ARRAY(2);
+#endif
+#if MATERIAL_ARRAY_COUNT > 3
+    SAMPLE_MATERIAL_ARRAY(3);
+#endif
+#if MATERIAL_ARRAY_COUNT > 4
+    SAMPLE_MATERIAL_ARRAY(4);
+#endif
+#if MATERIAL_ARRAY_COUNT > 5
+    SAMPLE_MATERIAL_ARRAY(5);
+#endif
+#if MATERIAL_ARRAY_COUNT > 6
+    SAMPLE_MATERIAL_ARRAY(6);
+#endif
+#if MATERIAL_ARRAY_COUNT > 7
+    SAMPLE_MATERIAL_ARRAY(7);
+#endif
+#if MATERIAL_ARRAY_COUNT > 8
+    SAMPLE_MATERIAL_ARRAY(8);
+#endif
+#if MATERIAL_ARRAY_COUNT > 9
+    SAMPLE_MATERIAL_ARRAY(9);
+#endif
+#if MATERIAL_ARRAY_COUNT > 10
+    SAMPLE_MATERIAL_ARRAY(10);
+#endif
+#if MATERIAL_ARRAY_COUNT > 11
+    SAMPLE_MATERIAL_ARRAY(11);
+#endif
+#if MATERIAL_ARRAY_COUNT > 12
+    SAMPLE_MATERIAL_ARRAY(12);
+#endif
+#if MATERIAL_ARRAY_COUNT > 13
+    SAMPLE_MATERIAL_ARRAY(13);
+#endif
+#if MATERIAL_ARRAY_COUNT > 14
+    SAMPLE_MATERIAL_ARRAY(14);
+#endif
+#if MATERIAL_ARRAY_COUNT > 15
+    SAMPLE_MATERIAL_ARRAY(15);
+#endif
+    // TextureStreamer's placeholder
+    return vec4(0.5, 0.5, 0.5, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec3 aNormal;
+
+// every attribute reaches the output so benchmarkVertexLayouts() fetches all of them
+uniform mat4 viewProj;
+
+out vec3 Color;
+
+void main()
+{
+    gl_Position = viewProj * vec4(aPos, 1.0);
+    Color = aNormal * 0.5 + 0.5 + vec3(aTexCoords, 0.0) * 0.01;
+}